@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "BatchRenderer.hpp"
+#include "Engine.hpp"
+
+namespace {
+    // Scripts comparing against a baseline tell a slower build from a run that failed.
+    constexpr int EXIT_REGRESSION = 1;
+    constexpr int EXIT_ERROR = 2;
+
+    struct Options {
+        uint32_t                  warmupFrames = 20;
+        uint32_t                  measuredFrames = 200;
+        std::vector<vk::Extent2D> resolutions;
+        std::string               outputPath = "benchmark.json";
+        std::string               baselinePath;
+        std::string               device;
+        // Frames rendered across all devices in batch mode, 0 runs the scenarios on one device instead.
+        uint64_t batchFrames = 0;
+        uint32_t maxDevices = UINT32_MAX;
+        // Relative slowdown of the median frame time reported as a regression.
+        double threshold = 0.1;
+    };
+
+    struct Scenario {
+        std::string name;
+        int         effect;
+        bool        geometry;
+    };
+
+    struct Summary {
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+    };
+
+    struct Result {
+        std::string            name;
+        vk::Extent2D           extent;
+        Summary                cpuMs;
+        std::optional<Summary> gpuMs;
+        double                 fps = 0.0;
+        double                 megapixelsPerSecond = 0.0;
+    };
+
+    struct BaselineEntry {
+        std::string           name;
+        double                cpuP50 = 0.0;
+        std::optional<double> gpuP50;
+    };
+
+    void printUsage() {
+        std::cout << "usage: VkRenderBenchmark [--warmup N] [--frames N] [--resolution WxH]... [--output FILE]\n"
+                  << "                         [--baseline FILE] [--threshold FRACTION] [--device INDEX|UUID|NAME]\n"
+                  << "       VkRenderBenchmark --batch N [--devices N] [--resolution WxH]...\n";
+    }
+
+    vk::Extent2D parseResolution(const std::string& text) {
+        vk::Extent2D       extent;
+        char               separator = 0;
+        std::istringstream stream(text);
+        if(!(stream >> extent.width >> separator >> extent.height) || separator != 'x' || extent.width == 0 ||
+           extent.height == 0) {
+            throw std::runtime_error("invalid resolution " + text);
+        }
+        return extent;
+    }
+
+    Options parseOptions(int argc, char** argv) {
+        Options options;
+        for(int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if(i + 1 >= argc) {
+                throw std::runtime_error("missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if(arg == "--warmup") {
+                options.warmupFrames = std::stoul(value);
+            } else if(arg == "--frames") {
+                options.measuredFrames = std::max(1ul, std::stoul(value));
+            } else if(arg == "--resolution") {
+                options.resolutions.push_back(parseResolution(value));
+            } else if(arg == "--output") {
+                options.outputPath = value;
+            } else if(arg == "--baseline") {
+                options.baselinePath = value;
+            } else if(arg == "--threshold") {
+                options.threshold = std::stod(value);
+            } else if(arg == "--device") {
+                options.device = value;
+            } else if(arg == "--batch") {
+                options.batchFrames = std::stoull(value);
+            } else if(arg == "--devices") {
+                options.maxDevices = std::max(1ul, std::stoul(value));
+            } else {
+                throw std::runtime_error("unknown option " + arg);
+            }
+        }
+        if(options.resolutions.empty()) {
+            options.resolutions = {{.width = 640, .height = 480},
+                                   {.width = 1280, .height = 720},
+                                   {.width = 1920, .height = 1080}};
+        }
+        return options;
+    }
+
+    /**
+     * Nearest-rank percentiles, exact for the small sample counts a benchmark run produces.
+     */
+    Summary summarize(std::vector<double> samples) {
+        std::ranges::sort(samples);
+        auto percentile = [&](double p) {
+            auto rank = static_cast<size_t>(std::ceil(p * samples.size()));
+            return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+        };
+        double total = 0.0;
+        for(double sample : samples) {
+            total += sample;
+        }
+        return {
+            .mean = total / samples.size(),
+            .p50 = percentile(0.50),
+            .p95 = percentile(0.95),
+            .p99 = percentile(0.99),
+        };
+    }
+
+    Result runScenario(Engine& engine, const Scenario& scenario, const Options& options) {
+        engine.setBackgroundEffect(scenario.effect);
+        engine.setDrawGeometry(scenario.geometry);
+        // Geometry scenarios keep the background cached so the frame time is dominated by the draws.
+        engine.setIncrementalBackground(scenario.geometry);
+
+        for(uint32_t i = 0; i < options.warmupFrames; i++) {
+            engine.drawOffscreen();
+        }
+
+        // GPU timings trail the CPU by the frames in flight, after warmup they all belong to this scenario.
+        std::vector<double> cpuMs;
+        std::vector<double> gpuMs;
+        cpuMs.reserve(options.measuredFrames);
+        gpuMs.reserve(options.measuredFrames);
+        const GpuProfiler& profiler = engine.getGpuProfiler();
+
+        auto start = std::chrono::steady_clock::now();
+        for(uint32_t i = 0; i < options.measuredFrames; i++) {
+            auto frameStart = std::chrono::steady_clock::now();
+            engine.drawOffscreen();
+            auto frameEnd = std::chrono::steady_clock::now();
+            cpuMs.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+            if(profiler.isSupported()) {
+                gpuMs.push_back(profiler.getFrameMs());
+            }
+        }
+        engine.waitIdle();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        vk::Extent2D extent = engine.getDrawExtent();
+        Result       result{
+            .name = scenario.name + "@" + std::to_string(extent.width) + "x" + std::to_string(extent.height),
+            .extent = extent,
+            .cpuMs = summarize(std::move(cpuMs)),
+        };
+        if(!gpuMs.empty()) {
+            result.gpuMs = summarize(std::move(gpuMs));
+        }
+        result.fps = options.measuredFrames / seconds;
+        result.megapixelsPerSecond = result.fps * extent.width * extent.height / 1e6;
+        return result;
+    }
+
+    std::vector<const char*> getInstanceExtensions() {
+#ifdef __APPLE__
+        return {vk::KHRPortabilityEnumerationExtensionName};
+#else
+        return {};
+#endif
+    }
+
+    std::vector<Result> runResolution(vk::Extent2D extent, const Options& options,
+                                      vk::PhysicalDeviceProperties& properties) {
+        Engine engine(getInstanceExtensions(), {});
+        engine.setDevicePreference(options.device);
+        engine.initHeadless(extent);
+        engine.waitForPipelines();
+        properties = engine.getDeviceProperties();
+
+        std::vector<Scenario> scenarios;
+        for(int i = 0; i < engine.getBackgroundEffectCount(); i++) {
+            scenarios.push_back({.name = engine.getBackgroundEffectName(i), .effect = i, .geometry = false});
+        }
+        scenarios.push_back({.name = "triangle", .effect = 0, .geometry = true});
+
+        std::vector<Result> results;
+        for(const auto& scenario : scenarios) {
+            results.push_back(runScenario(engine, scenario, options));
+        }
+        return results;
+    }
+
+    /**
+     * Spreads independent frames, cycling through the background effects, over every suitable device and reports
+     * the combined throughput. Comparing with --devices 1 shows how it scales.
+     */
+    void runBatch(vk::Extent2D extent, const Options& options) {
+        BatchRenderer batch(getInstanceExtensions(), extent, options.maxDevices);
+
+        auto setup = [](Engine& engine, uint64_t frame) {
+            engine.setBackgroundEffect(static_cast<int>(frame % engine.getBackgroundEffectCount()));
+        };
+        batch.render(std::min<uint64_t>(options.warmupFrames, options.batchFrames), setup);
+
+        auto start = std::chrono::steady_clock::now();
+        batch.render(options.batchFrames, setup);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double fps = options.batchFrames / seconds;
+        std::cout << "\nbatch@" << extent.width << "x" << extent.height << ": " << options.batchFrames
+                  << " frames on " << batch.getDeviceCount() << " device(s) in " << seconds << " s, " << fps
+                  << " fps, " << fps * extent.width * extent.height / 1e6 << " megapixels/s\n";
+        for(uint32_t i = 0; i < batch.getDeviceCount(); i++) {
+            std::cout << "  " << batch.getDevice(i).name << ": " << batch.getDeviceFrameCounts()[i] << " frames\n";
+        }
+    }
+
+    std::string escapeJson(const std::string& text) {
+        std::string escaped;
+        for(char c : text) {
+            if(c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    void writeSummary(std::ostream& out, const Summary& summary) {
+        out << "{\"mean\": " << summary.mean << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95
+            << ", \"p99\": " << summary.p99 << "}";
+    }
+
+    /**
+     * One scenario per line, so the baseline reader below gets away without a JSON parser.
+     */
+    void writeReport(const std::string& path, const vk::PhysicalDeviceProperties& properties,
+                     const std::vector<Result>& results, const Options& options) {
+        std::ofstream out(path, std::ios::trunc);
+        if(!out.is_open()) {
+            throw std::runtime_error("failed to write " + path);
+        }
+        out << "{\n";
+        out << "\"device\": \"" << escapeJson(properties.deviceName.data()) << "\",\n";
+        out << "\"deviceType\": \"" << vk::to_string(properties.deviceType) << "\",\n";
+        out << "\"driverVersion\": " << properties.driverVersion << ",\n";
+        out << "\"warmupFrames\": " << options.warmupFrames << ",\n";
+        out << "\"measuredFrames\": " << options.measuredFrames << ",\n";
+        out << "\"scenarios\": [\n";
+        for(size_t i = 0; i < results.size(); i++) {
+            const Result& result = results[i];
+            out << "{\"name\": \"" << escapeJson(result.name) << "\", \"width\": " << result.extent.width
+                << ", \"height\": " << result.extent.height << ", \"cpuMs\": ";
+            writeSummary(out, result.cpuMs);
+            out << ", \"gpuMs\": ";
+            if(result.gpuMs) {
+                writeSummary(out, *result.gpuMs);
+            } else {
+                out << "null";
+            }
+            out << ", \"fps\": " << result.fps << ", \"megapixelsPerSecond\": " << result.megapixelsPerSecond << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "]\n}\n";
+    }
+
+    std::optional<double> findNumber(const std::string& line, const std::string& key, size_t from = 0) {
+        auto position = line.find("\"" + key + "\": ", from);
+        if(position == std::string::npos) {
+            return std::nullopt;
+        }
+        try {
+            return std::stod(line.substr(position + key.size() + 4));
+        } catch(const std::exception&) {
+            // null
+            return std::nullopt;
+        }
+    }
+
+    std::vector<BaselineEntry> readBaseline(const std::string& path) {
+        std::ifstream file(path);
+        if(!file.is_open()) {
+            throw std::runtime_error("failed to read baseline " + path);
+        }
+        const std::string          nameKey = "{\"name\": \"";
+        std::vector<BaselineEntry> entries;
+        std::string                line;
+        while(std::getline(file, line)) {
+            auto nameStart = line.find(nameKey);
+            if(nameStart == std::string::npos) {
+                continue;
+            }
+            nameStart += nameKey.size();
+            BaselineEntry entry{.name = line.substr(nameStart, line.find('"', nameStart) - nameStart)};
+
+            auto cpuP50 = findNumber(line, "p50", line.find("\"cpuMs\""));
+            if(!cpuP50) {
+                continue;
+            }
+            entry.cpuP50 = *cpuP50;
+            auto gpuStart = line.find("\"gpuMs\": {");
+            if(gpuStart != std::string::npos) {
+                entry.gpuP50 = findNumber(line, "p50", gpuStart);
+            }
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    /**
+     * Compares median frame times, GPU when both runs have them since they do not include driver overhead.
+     * Returns the number of scenarios slower than the baseline by more than the threshold.
+     */
+    uint32_t compareBaseline(const std::vector<Result>& results, const std::vector<BaselineEntry>& baseline,
+                             double threshold) {
+        uint32_t regressions = 0;
+        std::cout << "\nComparison against baseline (p50):\n";
+        for(const auto& result : results) {
+            auto it = std::ranges::find_if(baseline, [&](const BaselineEntry& e) { return e.name == result.name; });
+            if(it == baseline.end()) {
+                std::cout << "  " << result.name << ": not in baseline\n";
+                continue;
+            }
+            bool   useGpu = result.gpuMs && it->gpuP50 && *it->gpuP50 > 0.0;
+            double current = useGpu ? result.gpuMs->p50 : result.cpuMs.p50;
+            double previous = useGpu ? *it->gpuP50 : it->cpuP50;
+            double change = previous > 0.0 ? current / previous - 1.0 : 0.0;
+            bool   regressed = change > threshold;
+            regressions += regressed;
+
+            std::cout << "  " << result.name << " (" << (useGpu ? "gpu" : "cpu") << "): " << previous << " ms -> "
+                      << current << " ms, " << (change >= 0.0 ? "+" : "") << change * 100.0 << "%"
+                      << (regressed ? "  REGRESSION" : "") << "\n";
+        }
+        return regressions;
+    }
+
+    int run(const Options& options) {
+        if(options.batchFrames > 0) {
+            for(auto extent : options.resolutions) {
+                runBatch(extent, options);
+            }
+            return 0;
+        }
+
+        std::vector<Result>          results;
+        vk::PhysicalDeviceProperties properties;
+        for(auto extent : options.resolutions) {
+            auto resolutionResults = runResolution(extent, options, properties);
+            results.insert(results.end(), resolutionResults.begin(), resolutionResults.end());
+        }
+
+        std::cout << "\n";
+        for(const auto& result : results) {
+            std::cout << result.name << ": cpu p50 " << result.cpuMs.p50 << " ms, p99 " << result.cpuMs.p99 << " ms";
+            if(result.gpuMs) {
+                std::cout << ", gpu p50 " << result.gpuMs->p50 << " ms, p99 " << result.gpuMs->p99 << " ms";
+            }
+            std::cout << ", " << result.fps << " fps\n";
+        }
+
+        writeReport(options.outputPath, properties, results, options);
+        std::cout << "Wrote " << options.outputPath << ".\n";
+
+        if(!options.baselinePath.empty()) {
+            uint32_t regressions = compareBaseline(results, readBaseline(options.baselinePath), options.threshold);
+            if(regressions > 0) {
+                std::cout << regressions << " scenario(s) regressed by more than " << options.threshold * 100.0
+                          << "%.\n";
+                return EXIT_REGRESSION;
+            }
+        }
+        return 0;
+    }
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        printUsage();
+        return EXIT_ERROR;
+    }
+
+    try {
+        return run(options);
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return EXIT_ERROR;
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+class DeviceAllocator;
+struct MemoryBlock;
+struct AllocatedImage;
+struct AllocatedBuffer;
+
+enum class MemoryUsage {
+    eGpuOnly,
+    eCpuToGpu,
+    eGpuToCpu,
+};
+
+/**
+ * What an allocation is for, memory is accounted per category.
+ */
+enum class MemoryCategory : uint32_t {
+    eRenderTarget,
+    eBuffer,
+    eStaging,
+    eReadback,
+};
+constexpr uint32_t MEMORY_CATEGORY_COUNT = 4;
+
+/**
+ * A range of a device memory block, returned to its allocator on destruction.
+ */
+class Allocation {
+    friend class DeviceAllocator;
+
+   private:
+    DeviceAllocator* m_allocator = nullptr;
+    MemoryBlock*     m_block = nullptr;
+    vk::DeviceSize   m_offset = 0;
+    vk::DeviceSize   m_size = 0;
+    MemoryCategory   m_category = MemoryCategory::eBuffer;
+
+   public:
+    Allocation() = default;
+    Allocation(std::nullptr_t) {}
+    Allocation(const Allocation&) = delete;
+    Allocation& operator=(const Allocation&) = delete;
+    Allocation(Allocation&& other) noexcept;
+    Allocation& operator=(Allocation&& other) noexcept;
+    ~Allocation();
+
+    explicit operator bool() const { return m_block != nullptr; }
+
+    vk::DeviceMemory getMemory() const;
+    vk::DeviceSize   getOffset() const { return m_offset; }
+    vk::DeviceSize   getSize() const { return m_size; }
+    MemoryCategory   getCategory() const { return m_category; }
+    void*            getMappedData() const;
+    void             release();
+};
+
+struct MemoryHeapStats {
+    vk::DeviceSize heapSize = 0;
+    // Reported by VK_EXT_memory_budget. The budget is how much this process can allocate from the heap before
+    // allocations may fail or slow down, usage is everything the process allocated from it, driver objects included.
+    // Without the extension the budget is the heap size and the usage the allocator's blocks.
+    vk::DeviceSize budget = 0;
+    vk::DeviceSize usage = 0;
+    vk::DeviceSize blockBytes = 0;
+    vk::DeviceSize usedBytes = 0;
+    uint32_t       blockCount = 0;
+    uint32_t       allocationCount = 0;
+};
+
+struct MemoryCategoryStats {
+    vk::DeviceSize bytes = 0;
+    uint32_t       allocationCount = 0;
+};
+
+struct MemoryBlock {
+    vk::raii::DeviceMemory memory = nullptr;
+    vk::DeviceSize         size = 0;
+    uint32_t               memoryTypeIndex = 0;
+    bool                   linear = true;
+    bool                   dedicated = false;
+    void*                  mapped = nullptr;
+    vk::DeviceSize         usedBytes = 0;
+    uint32_t               allocationCount = 0;
+
+    // Free ranges keyed by offset, neighbours are merged on free.
+    std::map<vk::DeviceSize, vk::DeviceSize> freeRanges;
+};
+
+/**
+ * Sub-allocates images and buffers from large per-memory-type blocks. Each block keeps an offset-ordered free list
+ * searched best-fit; buffers and optimal-tiling images live in separate blocks whenever bufferImageGranularity would
+ * otherwise force padding between them. Requests larger than half a block get a dedicated allocation.
+ */
+class DeviceAllocator {
+    friend class Allocation;
+
+   public:
+    static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+   private:
+    vk::raii::Device*                                      m_device = nullptr;
+    const vk::raii::PhysicalDevice*                        m_gpu = nullptr;
+    bool                                                   m_memoryBudget = false;
+    vk::PhysicalDeviceMemoryProperties                     m_memoryProperties;
+    vk::DeviceSize                                         m_bufferImageGranularity = 1;
+    bool                                                   m_bufferDeviceAddress = false;
+    std::vector<std::unique_ptr<MemoryBlock>>              m_blocks;
+    std::array<MemoryCategoryStats, MEMORY_CATEGORY_COUNT> m_categoryStats{};
+    mutable std::mutex                                     m_mutex;
+
+   public:
+    DeviceAllocator() = default;
+    DeviceAllocator(const DeviceAllocator&) = delete;
+    DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+
+    /**
+     * With bufferDeviceAddress every block is allocated addressable, buffers created with eShaderDeviceAddress then
+     * carry their address. memoryBudget tells that the device was created with VK_EXT_memory_budget.
+     */
+    void init(const vk::raii::PhysicalDevice& gpu, vk::raii::Device& device, bool bufferDeviceAddress = false,
+              bool memoryBudget = false);
+
+    Allocation allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage, MemoryCategory category,
+                        bool linear);
+
+    AllocatedImage  createImage(const vk::ImageCreateInfo& imageInfo, MemoryUsage usage, MemoryCategory category,
+                                vk::ImageAspectFlags aspectFlags = vk::ImageAspectFlagBits::eColor);
+    /**
+     * Passing more than one queue family, all distinct, makes the buffer concurrently shared between them.
+     */
+    AllocatedBuffer createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, MemoryUsage memoryUsage,
+                                 MemoryCategory category, std::span<const uint32_t> queueFamilies = {});
+
+    /**
+     * Queries the current budget of every heap, cheap enough to call once per frame.
+     */
+    std::vector<MemoryHeapStats> getHeapStats() const;
+    bool                         hasMemoryBudget() const { return m_memoryBudget; }
+    /**
+     * Bytes requested by the live allocations of each category, indexed by MemoryCategory.
+     */
+    std::array<MemoryCategoryStats, MEMORY_CATEGORY_COUNT> getCategoryStats() const;
+    static const char*                                     getCategoryName(MemoryCategory category);
+
+   private:
+    void                  free(Allocation& allocation);
+    std::vector<uint32_t> findMemoryTypes(uint32_t typeFilter, MemoryUsage usage) const;
+    vk::DeviceSize        getBlockSize(uint32_t memoryTypeIndex) const;
+    MemoryBlock&          createBlock(uint32_t memoryTypeIndex, vk::DeviceSize size, bool linear, bool dedicated);
+    static bool           tryAllocateFromBlock(MemoryBlock& block, vk::DeviceSize size, vk::DeviceSize alignment,
+                                               vk::DeviceSize& outOffset);
+};
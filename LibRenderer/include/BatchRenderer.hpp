@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "Engine.hpp"
+
+/**
+ * Offline rendering of independent frames spread across every suitable device. Each device gets its own headless
+ * engine and a thread driving it, and the threads take the next frame index from a shared counter, so faster devices
+ * simply render more of the frames. Throughput grows with the device count as long as frames don't depend on each
+ * other.
+ *
+ * Engines are created one after another, so they read and write the shared workgroup size cache in turn. Each one
+ * keeps its pipeline cache in its own file named after the device UUID.
+ */
+class BatchRenderer {
+   public:
+    /**
+     * Configures the engine for a frame before it is drawn, called on that engine's thread.
+     */
+    using FrameSetup = std::function<void(Engine& engine, uint64_t frameIndex)>;
+    /**
+     * Receives a drawn frame as RGBA16F texels, see Engine::readbackDrawImage(). Called concurrently from the device
+     * threads.
+     */
+    using FrameOutput = std::function<void(uint64_t frameIndex, uint32_t device, std::vector<uint8_t>&& texels)>;
+
+   private:
+    std::vector<std::unique_ptr<Engine>> m_engines;
+    std::vector<DeviceCandidate>         m_devices;
+    std::vector<uint64_t>                m_deviceFrameCounts;
+
+   public:
+    /**
+     * Uses at most maxDevices of the suitable devices, best scored first.
+     */
+    BatchRenderer(const std::vector<const char*>& extensions, vk::Extent2D extent, uint32_t maxDevices = UINT32_MAX);
+
+    /**
+     * Draws frames [0, frameCount) and returns once all of them finished on the GPU. Without an output the frames are
+     * only drawn, which measures the rendering throughput alone. Rethrows the first error of any device thread.
+     */
+    void render(uint64_t frameCount, const FrameSetup& setup, const FrameOutput& output = {});
+
+    uint32_t               getDeviceCount() const { return static_cast<uint32_t>(m_engines.size()); }
+    Engine&                getEngine(uint32_t device) { return *m_engines[device]; }
+    const DeviceCandidate& getDevice(uint32_t device) const { return m_devices[device]; }
+    /**
+     * Frames each device drew during the last render().
+     */
+    const std::vector<uint64_t>& getDeviceFrameCounts() const { return m_deviceFrameCounts; }
+};
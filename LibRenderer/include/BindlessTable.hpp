@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+enum class BindlessType : uint32_t {
+    eStorageImage = 0,
+    eSampledImage,
+    eStorageBuffer,
+    eCount,
+};
+
+constexpr uint32_t BINDLESS_TYPE_COUNT = static_cast<uint32_t>(BindlessType::eCount);
+
+/**
+ * One global update-after-bind, partially bound descriptor set with a large array per resource type; the binding
+ * number is the BindlessType. Resources get a stable index that shaders read from push constants, so a command
+ * buffer binds the set once instead of allocating and binding a set per pass.
+ *
+ * Indices still referenced by frames in flight are retired with the frame count, like DeletionQueue entries, and only
+ * reused once collect() sees that many frames completed.
+ */
+class BindlessTable {
+   public:
+    static constexpr uint32_t DEFAULT_CAPACITY = 1024;
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+
+   private:
+    struct Binding {
+        uint32_t              capacity = 0;
+        uint32_t              next = 0;
+        std::vector<uint32_t> freeIndices;
+    };
+
+    vk::raii::Device*             m_device = nullptr;
+    vk::raii::DescriptorPool      m_pool = nullptr;
+    vk::raii::DescriptorSetLayout m_layout = nullptr;
+    vk::DescriptorSet             m_set;
+
+    std::array<Binding, BINDLESS_TYPE_COUNT>                 m_bindings;
+    std::deque<std::tuple<uint64_t, BindlessType, uint32_t>> m_retired;
+    std::mutex                                               m_mutex;
+
+   public:
+    static bool isSupported(const vk::PhysicalDeviceVulkan12Features& features);
+    static void enableFeatures(vk::PhysicalDeviceVulkan12Features& features);
+
+    void init(vk::raii::Device& device, const vk::raii::PhysicalDevice& gpu);
+
+    uint32_t addStorageImage(vk::ImageView imageView);
+    uint32_t addSampledImage(vk::ImageView imageView,
+                             vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+    uint32_t addStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = vk::WholeSize);
+
+    void retire(BindlessType type, uint32_t index, uint64_t retireFrame);
+    void collect(uint64_t completedFrames);
+
+    void bind(vk::CommandBuffer cmd, vk::PipelineBindPoint bindPoint, vk::PipelineLayout layout) const;
+
+    vk::DescriptorSetLayout getLayout() const { return m_layout; }
+    uint32_t getCapacity(BindlessType type) const { return m_bindings[static_cast<uint32_t>(type)].capacity; }
+
+   private:
+    uint32_t acquire(BindlessType type);
+    void     write(BindlessType type, uint32_t index, const vk::DescriptorImageInfo* imageInfo,
+                   const vk::DescriptorBufferInfo* bufferInfo);
+};
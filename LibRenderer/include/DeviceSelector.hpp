@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+/**
+ * A physical device as seen by device selection. Unsuitable devices lack an API version, feature, queue or
+ * extension the engine requires and are never chosen.
+ */
+struct DeviceCandidate {
+    // Index into Instance::enumeratePhysicalDevices().
+    uint32_t               index = 0;
+    std::string            name;
+    std::string            uuid;
+    vk::PhysicalDeviceType type = vk::PhysicalDeviceType::eOther;
+    // Size of the largest device-local heap.
+    vk::DeviceSize deviceLocalBytes = 0;
+    bool           asyncCompute = false;
+    bool           dedicatedTransfer = false;
+    bool           suitable = false;
+    std::string    unsuitableReason;
+    uint64_t       score = 0;
+};
+
+/**
+ * Ranks physical devices instead of taking the first one enumerated, which on hybrid and multi-GPU machines is often
+ * the slower device. The device type dominates the score, discrete before integrated before virtual before CPU. Within
+ * a type, an async compute family, a dedicated transfer family and more device-local memory each add points.
+ */
+class DeviceSelector {
+   public:
+    static constexpr uint64_t ASYNC_COMPUTE_SCORE = 200;
+    static constexpr uint64_t DEDICATED_TRANSFER_SCORE = 100;
+    // One point per this many bytes of the largest device-local heap.
+    static constexpr vk::DeviceSize DEVICE_LOCAL_BYTES_PER_POINT = 64ull * 1024 * 1024;
+
+    /**
+     * Every device, suitable ones first and best first. With a surface, devices whose graphics queue family cannot
+     * present to it are unsuitable.
+     */
+    static std::vector<DeviceCandidate> rank(const std::vector<vk::raii::PhysicalDevice>& gpus,
+                                             vk::SurfaceKHR                               surface = nullptr);
+    /**
+     * The best suitable candidate, or the suitable one matching preference: a device index, a UUID, or part of a
+     * device name, case-insensitive. Throws when the preference matches no suitable device.
+     */
+    static const DeviceCandidate& select(const std::vector<DeviceCandidate>& candidates, const std::string& preference);
+    static void                   print(const std::vector<DeviceCandidate>& candidates);
+
+   private:
+    static DeviceCandidate evaluate(const vk::raii::PhysicalDevice& gpu, uint32_t index, vk::SurfaceKHR surface);
+    static bool            matches(const DeviceCandidate& candidate, const std::string& preference);
+};
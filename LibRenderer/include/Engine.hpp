@@ -1,5 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vulkan/vulkan_raii.hpp>
 
 #ifndef VK_USE_PLATFORM_METAL_EXT
@@ -8,18 +13,52 @@
 #include <imgui_impl_vulkan.h>
 #endif
 
+#include "Allocator.hpp"
+#include "BindlessTable.hpp"
+#include "DeviceSelector.hpp"
+#include "FrameCapture.hpp"
+#include "GpuProfiler.hpp"
+#include "PipelineCache.hpp"
+#include "RenderGraph.hpp"
+#include "ShaderLibrary.hpp"
+#include "ShaderWatcher.hpp"
 #include "Structs.hpp"
+#include "ThreadPool.hpp"
+#include "Tracer.hpp"
+#include "TripleBuffer.hpp"
+#include "UploadManager.hpp"
 #include "Utils.hpp"
+#include "WorkgroupSizeCache.hpp"
 
 #ifndef VK_USE_PLATFORM_METAL_EXT
+/**
+ * Deep copy of one frame's ImGui draw data, so the render thread can draw it while the main thread already builds
+ * the next one. The draw lists are kept and refilled each time the slot is reused.
+ */
+struct GuiSnapshot {
+    ImDrawData                               drawData;
+    std::vector<std::unique_ptr<ImDrawList>> drawLists;
+
+    void copyFrom(const ImDrawData& source);
+};
+#endif
+
+/**
+ * Everything the main thread hands to the thread that draws for one frame.
+ */
+struct FrameInput {
+    FrameSettings settings;
+#ifndef VK_USE_PLATFORM_METAL_EXT
+    GuiSnapshot gui;
 #endif
+};
 
 using CAMetalLayer = void;
 
 /**
- * Frames in flight.
+ * Upper bound for the runtime frames in flight setting.
  */
-constexpr uint8_t FRAME_OVERLAP = 2;
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
 
 class Engine {
    public:
@@ -28,9 +67,31 @@ class Engine {
    private:
     vk::raii::Context        m_context;
     vk::raii::SurfaceKHR     m_surface = nullptr;
+    bool                     m_surfaceMaintenance1 = false;
     vk::raii::PhysicalDevice m_chosenGPU = nullptr;
+    std::string              m_devicePreference;
     vk::raii::Device         m_device = nullptr;
     vk::raii::Queue          m_graphicsQueue = nullptr;
+    vk::raii::Queue          m_computeQueue = nullptr;
+    // Held for every submit and present to the graphics queue, uploads may submit to it from other threads.
+    std::mutex m_graphicsQueueMutex;
+    // Set when a compute-only queue family exists, background effects then overlap the graphics work.
+    bool m_asyncCompute = false;
+    DeviceAllocator          m_allocator;
+    bool                     m_memoryBudget = false;
+    UploadManager            m_uploadManager;
+    FrameCapture             m_frameCapture;
+    PipelineCache            m_pipelineCache;
+    std::filesystem::path    m_pipelineCachePath;
+    WorkgroupSizeCache       m_workgroupSizeCache;
+    std::filesystem::path    m_workgroupCachePath;
+    bool                     m_workgroupTuning = true;
+    ShaderLibrary            m_shaderLibrary;
+    ShaderSource             m_shaderSource = ShaderSource::eEmbedded;
+    bool                     m_shaderHotReload = false;
+    ShaderWatcher            m_shaderWatcher;
+
+    vk::Extent2D m_headlessExtent;
 
     vk::raii::SwapchainKHR           m_swapchain = nullptr;
     vk::SurfaceFormatKHR             m_swapchainImageFormat;
@@ -38,16 +99,63 @@ class Engine {
     std::vector<vk::Image>           m_swapchainImages;
     std::vector<vk::raii::ImageView> m_swapchainImageViews;
     std::vector<vk::raii::Semaphore> m_swapchainRenderSemaphores;
+    vk::PresentModeKHR               m_requestedPresentMode = vk::PresentModeKHR::eFifo;
+    vk::PresentModeKHR               m_presentMode = vk::PresentModeKHR::eFifo;
+    vk::Extent2D                     m_windowExtent;
+    bool                             m_swapchainDirty = false;
+    std::atomic<bool>                m_minimized = false;
+    // Old swapchains with their views and semaphores, tagged with m_presentCount when they were replaced. Presents
+    // may still wait on the semaphores after the frame timeline passed, so they are retired by present completion.
+    DeletionQueue m_retiredSwapchains;
+    uint64_t      m_presentCount = 0;
+    uint64_t      m_completedPresents = 0;
+    // VK_EXT_swapchain_maintenance1, every present signals a fence once it no longer uses the swapchain.
+    bool                         m_swapchainMaintenance1 = false;
+    std::deque<vk::raii::Fence>  m_presentFences;
+    std::vector<vk::raii::Fence> m_freePresentFences;
+    // Without present fences, an old swapchain is released once every image of its replacement was acquired.
+    std::vector<bool> m_swapchainImagesAcquired;
+    uint64_t          m_swapchainPresentCount = 0;
+
+    vk::raii::CommandPool  m_commandPool = nullptr;
+    std::vector<FrameData> m_frames;
+    uint32_t               m_requestedFramesInFlight = 2;
+    uint64_t               m_frameNumber = 0;
+    vk::raii::Semaphore    m_frameTimeline = nullptr;
+    vk::raii::CommandPool  m_computeCommandPool = nullptr;
+    vk::raii::Semaphore    m_computeTimeline = nullptr;
+    DeletionQueue          m_deletionQueue;
+
+    GpuProfiler m_gpuProfiler;
+    // Rebuilt every frame, one per queue that records a frame's work.
+    RenderGraph m_renderGraph;
+    RenderGraph m_computeGraph;
 
-    vk::raii::CommandPool m_commandPool = nullptr;
-    FrameData             m_frames[FRAME_OVERLAP];
-    uint32_t              m_frameNumber = 0;
+    vk::raii::CommandPool   m_immCommandPool = nullptr;
+    vk::raii::CommandBuffer m_immCommandBuffer = nullptr;
+    vk::raii::Fence         m_immFence = nullptr;
 
     AllocatedImage                m_drawImage;
-    DescriptorAllocator           m_globalDescriptorAllocator;
-    vk::raii::DescriptorSet       m_drawImageDescriptorSet = nullptr;
     vk::raii::DescriptorSetLayout m_drawImageDescriptorSetLayout = nullptr;
 
+    // With dynamic resolution the frame covers only the top-left m_renderExtent of the draw image, which keeps the
+    // swapchain size, and the blit stretches it.
+    bool         m_dynamicResolution = false;
+    float        m_renderScale = 1.f;
+    float        m_minRenderScale = 0.5f;
+    float        m_targetFrameMs = 1000.f / 60.f;
+    vk::Extent2D m_renderExtent;
+
+    // Skip shading the background when the effect inputs match what a frame's background image already holds.
+    bool m_incrementalBackground = true;
+    bool m_backgroundReused = false;
+
+    // Set when bindless was requested and the device supports the descriptor indexing features it needs.
+    bool          m_bindlessRequested = true;
+    bool          m_bindless = false;
+    BindlessTable m_bindlessTable;
+    uint32_t      m_drawImageIndex = BindlessTable::INVALID_INDEX;
+
     vk::raii::Pipeline       m_gradientPipeline = nullptr;
     vk::raii::PipelineLayout m_gradientPipelineLayout = nullptr;
 
@@ -57,10 +165,42 @@ class Engine {
     vk::raii::Pipeline       m_trianglePipeline = nullptr;
     vk::raii::PipelineLayout m_trianglePipelineLayout = nullptr;
 
+    vk::raii::Pipeline       m_meshPipeline = nullptr;
+    vk::raii::PipelineLayout m_meshPipelineLayout = nullptr;
+    MeshScene                m_meshScene;
+
+    std::vector<PendingPipeline>               m_pendingPipelines;
+    std::vector<ReloadablePipeline>            m_reloadablePipelines;
+    std::vector<std::pair<std::string, float>> m_pipelineCompileTimes;
+
 #ifndef VK_USE_PLATFORM_METAL_EXT
     vk::raii::DescriptorPool m_imguiPool = nullptr;
 #endif
 
+    bool m_parallelRecording = true;
+    bool m_drawGeometry = true;
+
+    // Heap stats of the last frame boundary, a heap is flagged once its usage crosses the threshold of its budget.
+    std::vector<MemoryHeapStats>                          m_memoryHeapStats;
+    std::vector<bool>                                     m_overBudgetHeaps;
+    float                                                 m_memoryBudgetThreshold = 0.9f;
+    std::function<void(uint32_t, const MemoryHeapStats&)> m_memoryBudgetCallback;
+
+    // Owned by the thread calling setupGui() and resize(), the main thread while the render thread runs.
+    FrameSettings m_guiSettings;
+    // The GUI settings the drawing thread applied last, only fields that differ from them are applied again.
+    FrameSettings            m_appliedSettings;
+    TripleBuffer<FrameInput> m_frameInputs;
+    TripleBuffer<FrameStats> m_frameStats;
+    std::thread              m_renderThread;
+    std::atomic<bool>        m_renderThreadRunning = false;
+    // ImGui updates its texture list while building a frame, drawing the GUI uploads the textures from it.
+    std::mutex m_guiTextureMutex;
+
+    // Declared last so workers are joined before anything they reference is destroyed.
+    ThreadPool m_recordThreads{RECORD_JOB_COUNT - 1};
+    ThreadPool m_threadPool;
+
    public:
 #ifdef VK_USE_PLATFORM_METAL_EXT
     Engine(CAMetalLayer* metalLayer, std::vector<const char*> extensions, std::vector<const char*> layers);
@@ -82,15 +222,226 @@ class Engine {
 
     void draw();
 
+    /**
+     * Calls draw() in a loop on a dedicated thread. The calling thread keeps polling events and building the GUI,
+     * setupGui() hands each GUI frame and the settings edited through it to the render thread without ever waiting
+     * on the GPU. While it runs, resize() and setupGui() are the only calls the main thread may make, resizes reach
+     * the render thread with the next setupGui(). Must be stopped before the surface goes away.
+     */
+    void startRenderThread();
+    void stopRenderThread();
+    bool isRenderThreadRunning() const { return m_renderThread.joinable(); }
+    /**
+     * Set while the surface has a zero extent, draw() then returns without drawing. Safe to read from any thread.
+     */
+    bool isMinimized() const { return m_minimized; }
+
+    /**
+     * The swapchain is rebuilt at the next frame boundary, in-flight frames keep using the old one until the frame
+     * timeline passes them. Unsupported present modes fall back to the closest supported one, FIFO as a last resort.
+     */
+    void               resize(uint32_t width, uint32_t height);
+    void               setPresentMode(vk::PresentModeKHR presentMode);
+    vk::PresentModeKHR getPresentMode() const { return m_presentMode; }
+
+    /**
+     * Takes effect at the next frame boundary, which waits for the GPU to drain the frames already submitted.
+     */
+    void setFramesInFlight(uint32_t count) { m_requestedFramesInFlight = std::clamp(count, 1u, MAX_FRAMES_IN_FLIGHT); }
+    uint32_t getFramesInFlight() const { return m_requestedFramesInFlight; }
+
+    /**
+     * Records the frame's secondary command buffers on worker threads, otherwise one after another on the calling
+     * thread.
+     */
+    void setParallelRecording(bool enabled) { m_parallelRecording = enabled; }
+    bool isParallelRecording() const { return m_parallelRecording; }
+
+    /**
+     * Scales the render extent each frame so the measured GPU frame time approaches the target, never below
+     * minScale of the draw image. Needs GPU timestamps, otherwise frames render at full size.
+     */
+    void setDynamicResolution(bool enabled) { m_dynamicResolution = enabled; }
+    void setTargetFrameTime(float ms, float minScale = 0.5f) {
+        m_targetFrameMs = ms;
+        m_minRenderScale = std::clamp(minScale, 0.1f, 1.f);
+    }
+    bool         isDynamicResolution() const { return m_dynamicResolution; }
+    float        getRenderScale() const { return m_renderScale; }
+    vk::Extent2D getRenderExtent() const { return m_renderExtent; }
+
+    /**
+     * Keep each frame's shaded background and reuse it while the effect, its parameters and the render extent are
+     * unchanged. Effects are pure functions of those inputs, so the result is identical either way. When off, the
+     * effect shades the draw image directly unless it runs on the async compute queue.
+     */
+    void setIncrementalBackground(bool enabled) { m_incrementalBackground = enabled; }
+    bool isIncrementalBackground() const { return m_incrementalBackground; }
+
+    /**
+     * The effect shading the background, the same choice as the effect slider of the GUI.
+     */
+    void setBackgroundEffect(int index) {
+        m_currentBackgroundEffect = std::clamp(index, 0, getBackgroundEffectCount() - 1);
+    }
+    int         getBackgroundEffect() const { return m_currentBackgroundEffect; }
+    int         getBackgroundEffectCount() const { return static_cast<int>(m_backgroundEffects.size()); }
+    const char* getBackgroundEffectName(int index) const { return m_backgroundEffects[index].name; }
+    /**
+     * Without geometry the frame is only the shaded background.
+     */
+    void setDrawGeometry(bool enabled) { m_drawGeometry = enabled; }
+    bool isDrawingGeometry() const { return m_drawGeometry; }
+
+    /**
+     * Headless mode: no surface and no swapchain, the frame stays in the draw image.
+     * readbackDrawImage() returns the last offscreen frame as tightly packed RGBA16F texels.
+     */
+    void                 initHeadless(vk::Extent2D extent);
+    void                 drawOffscreen();
+    std::vector<uint8_t> readbackDrawImage();
+    vk::Extent2D         getDrawExtent() const {
+        return {.width = m_drawImage.imageExtent.width, .height = m_drawImage.imageExtent.height};
+    }
+
+    /**
+     * Picks the GPU by index, UUID or part of its name instead of the best scored one, see DeviceSelector. Must be
+     * set before init, which throws when no suitable device matches.
+     */
+    void setDevicePreference(const std::string& preference) { m_devicePreference = preference; }
+    /**
+     * Every physical device of the instance, best first. With a surface, devices that cannot present to it are
+     * ranked unsuitable.
+     */
+    std::vector<DeviceCandidate> rankDevices() const;
+
+    /**
+     * Must be called before init. The cache defaults to PIPELINE_CACHE_PATH, shaders to the embedded SPIR-V when
+     * the library was built with EMBED_SHADERS.
+     */
+    void setPipelineCachePath(const std::filesystem::path& path) { m_pipelineCachePath = path; }
+    void setShaderSource(ShaderSource source) { m_shaderSource = source; }
+    /**
+     * Compute effects index one global descriptor table instead of binding a set per pass. Falls back to per-pass
+     * sets when descriptor indexing is unsupported. Must be set before init.
+     */
+    void setBindless(bool enabled) { m_bindlessRequested = enabled; }
+    bool isBindless() const { return m_bindless; }
+    /**
+     * Recompile shaders whose GLSL source changes while running and rebuild the pipelines using them in the
+     * background. New pipelines replace the old ones at a frame boundary. Must be set before init.
+     */
+    void setShaderHotReload(bool enabled) { m_shaderHotReload = enabled; }
+    /**
+     * Compute effects without a cached workgroup size for this device are benchmarked at init with every candidate
+     * size and keep the fastest. Sizes are cached in WORKGROUP_CACHE_PATH by default. Must be set before init.
+     */
+    void setWorkgroupTuning(bool enabled) { m_workgroupTuning = enabled; }
+    void setWorkgroupCachePath(const std::filesystem::path& path) { m_workgroupCachePath = path; }
+
+    /**
+     * Write the draw image of every following frame, or only of the next one, to numbered files in directory. The
+     * copies are encoded on worker threads and never stall drawing, see FrameCapture.
+     */
+    void startRecording(const std::filesystem::path& directory, CaptureFormat format) {
+        m_frameCapture.record(directory, format);
+    }
+    void stopRecording() { m_frameCapture.stop(); }
+    void captureScreenshot(const std::filesystem::path& directory, CaptureFormat format) {
+        m_frameCapture.screenshot(directory, format);
+    }
+    const FrameCapture& getFrameCapture() const { return m_frameCapture; }
+
+    const GpuProfiler&           getGpuProfiler() const { return m_gpuProfiler; }
+    vk::PhysicalDeviceProperties getDeviceProperties() const { return m_chosenGPU.getProperties(); }
+    /**
+     * Blocks until every submitted frame has finished on the GPU.
+     */
+    void waitIdle() const { m_device.waitIdle(); }
+
+    std::vector<MemoryHeapStats> getMemoryHeapStats() const { return m_allocator.getHeapStats(); }
+    bool                         hasMemoryBudget() const { return m_memoryBudget; }
+    /**
+     * Bytes held by the allocator's live allocations, indexed by MemoryCategory.
+     */
+    std::array<MemoryCategoryStats, MEMORY_CATEGORY_COUNT> getMemoryCategoryStats() const {
+        return m_allocator.getCategoryStats();
+    }
+    /**
+     * Heap budgets are checked at every frame boundary. The callback runs on the drawing thread when a heap's usage
+     * rises above threshold times its budget, and again only after it went back below, so callers can shed
+     * resolution or caches before allocations fail. Without VK_EXT_memory_budget the budget is the heap size and
+     * only the allocator's own blocks count as usage. Must be set before the render thread starts.
+     */
+    void setMemoryBudgetCallback(float threshold,
+                                 std::function<void(uint32_t heapIndex, const MemoryHeapStats& stats)> callback) {
+        m_memoryBudgetThreshold = threshold;
+        m_memoryBudgetCallback = std::move(callback);
+    }
+
+    /**
+     * Device-local buffer filled through the upload manager, shared between the graphics and transfer families.
+     */
+    AllocatedBuffer createDeviceBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage);
+    UploadManager&  getUploadManager() { return m_uploadManager; }
+
+    /**
+     * Pipelines compile on worker threads, drawing starts right away and uses a fallback until they are ready.
+     */
+    void waitForPipelines();
+    bool arePipelinesReady() const { return m_pendingPipelines.empty(); }
+    const std::vector<std::pair<std::string, float>>& getPipelineCompileTimes() const { return m_pipelineCompileTimes; }
+
    private:
-    void       initVulkan();
-    uint32_t   getGraphicsQueueFamilyIndex();
-    void       createSwapchain();
-    FrameData& getCurrentFame() { return m_frames[m_frameNumber % FRAME_OVERLAP]; }
-    void       initFrameDatas();
-    void       drawBackground(vk::CommandBuffer cmd, vk::Image image);
-    void       initDescriptors();
-    void       initComputePipeline();
-    void       initTrianglePipeline();
-    void       drawGeometry(vk::CommandBuffer cmd);
+    void               initVulkan();
+    uint32_t           getGraphicsQueueFamilyIndex();
+    uint32_t           getComputeQueueFamilyIndex();
+    uint32_t           getTransferQueueFamilyIndex();
+    void               addFrameWaits(std::vector<vk::SemaphoreSubmitInfo>& waitInfos, uint64_t frameValue);
+    void               createSwapchain();
+    bool               recreateSwapchain();
+    void               collectRetiredSwapchains(uint32_t acquiredImageIndex);
+    vk::PresentModeKHR choosePresentMode() const;
+    void               createDrawImage(vk::Extent2D extent);
+    FrameData&         getCurrentFame() { return m_frames[m_frameNumber % m_frames.size()]; }
+    void               initFrameDatas(uint32_t framesInFlight);
+    FrameData&         beginFrame();
+    void               initImmediateSubmit();
+    void               immediateSubmit(std::function<void(vk::CommandBuffer cmd)>&& function);
+    void               drawBackground(vk::CommandBuffer cmd, const AllocatedImage& target, vk::DescriptorSet set,
+                                      uint32_t bindlessIndex);
+    void               dispatchEffect(vk::CommandBuffer cmd, const ComputeEffect& effect, vk::Pipeline pipeline,
+                                      vk::Extent2D workgroupSize, vk::Extent2D extent, vk::DescriptorSet set,
+                                      uint32_t bindlessIndex);
+    void               submitBackgroundCompute(FrameData& frame);
+    void               createBackgroundImages();
+    void               updateRenderExtent();
+    void               initDescriptors();
+    vk::DescriptorSet  allocateStorageImageSet(FrameData& frame, vk::ImageView imageView);
+    void               initComputePipeline();
+    void               tuneWorkgroupSizes();
+    void               initTrianglePipeline();
+    void               initMeshPipeline();
+    void               initMeshScene();
+    void               queuePipelineJob(const std::string& name, vk::raii::Pipeline* target,
+                                        std::function<vk::raii::Pipeline()>&& build);
+    void               registerPipeline(const std::string& name, vk::raii::Pipeline* target,
+                                        std::vector<std::string> shaders, std::function<vk::raii::Pipeline()> build);
+    void               reloadChangedShaders();
+    void               initGuiSettings();
+    void               applySettings(const FrameSettings& settings);
+    void               publishFrameStats();
+    void               checkMemoryBudget();
+    void               collectPipelines();
+    vk::raii::Pipeline buildComputePipeline(const char* shader, vk::Extent2D workgroupSize);
+    vk::raii::Pipeline buildTrianglePipeline();
+    vk::raii::Pipeline buildMeshPipeline();
+    void               drawGeometry(vk::CommandBuffer cmd);
+    void               drawMeshes(vk::CommandBuffer cmd);
+    void               recordSecondary(FrameData& frame, RecordJob job);
+    void               recordSecondaries(FrameData& frame);
+    ResourceUsage      getBackgroundUsage() const;
+    void               updateBackgroundKey(FrameData& frame);
+    void               addScenePasses(RenderGraph& graph, const FrameData& frame, RenderGraphResource drawImage);
+    void               addCapturePass(RenderGraph& graph, RenderGraphResource drawImage, uint64_t timelineValue);
 };
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "Allocator.hpp"
+#include "Structs.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * Records draw image frames to disk without stalling the frame loop. Each captured frame is copied into one of a ring
+ * of persistently mapped readback buffers. The buffer goes to the writer threads once the frame timeline passes the
+ * frame that filled it, and it is reused after its file is written. When every buffer is still waiting or being
+ * written, the frame is skipped and counted as dropped instead of waiting.
+ *
+ * Files are numbered per capture in the target directory. PNG is 8-bit RGB clamped from the linear frame and
+ * stored without compression. EXR keeps the half float RGBA texels. Raw is the texels as they are, with the extent
+ * in the file name.
+ */
+class FrameCapture {
+   public:
+    static constexpr uint32_t RING_SIZE = 8;
+    static constexpr uint32_t WRITER_COUNT = 2;
+
+   private:
+    enum class SlotState : uint32_t {
+        eFree,
+        // Copy recorded, waiting for the frame timeline.
+        eInFlight,
+        eWriting,
+    };
+
+    struct Slot {
+        AllocatedBuffer        buffer;
+        vk::Extent2D           extent;
+        uint64_t               timelineValue = 0;
+        std::filesystem::path  path;
+        std::atomic<SlotState> state = SlotState::eFree;
+    };
+
+    DeviceAllocator*      m_allocator = nullptr;
+    std::filesystem::path m_directory;
+    CaptureFormat         m_format = CaptureFormat::ePng;
+    // Frames left to capture, UINT64_MAX while recording.
+    uint64_t              m_remainingFrames = 0;
+    uint64_t              m_sequence = 0;
+    std::atomic<uint64_t> m_writtenCount = 0;
+    uint64_t              m_droppedCount = 0;
+
+    std::array<Slot, RING_SIZE> m_slots;
+    // Declared last, pending writes finish before the buffers they read are destroyed.
+    ThreadPool m_writers{WRITER_COUNT};
+
+   public:
+    void init(DeviceAllocator& allocator) { m_allocator = &allocator; }
+
+    void record(const std::filesystem::path& directory, CaptureFormat format);
+    void screenshot(const std::filesystem::path& directory, CaptureFormat format);
+    void stop() { m_remainingFrames = 0; }
+    bool isRecording() const { return m_remainingFrames == UINT64_MAX; }
+    bool isCapturing() const { return m_remainingFrames > 0; }
+
+    /**
+     * Claims a buffer for the frame signaling timelineValue and returns it, or nullptr when nothing is captured this
+     * frame. The caller records the copy of the extent's texels into it.
+     */
+    vk::Buffer beginFrame(vk::Extent2D extent, uint64_t timelineValue);
+    /**
+     * Hands every copy completed by the frame timeline value to the writers.
+     */
+    void collect(uint64_t completedValue);
+
+    uint64_t getWrittenCount() const { return m_writtenCount.load(std::memory_order_relaxed); }
+    uint64_t getDroppedCount() const { return m_droppedCount; }
+
+   private:
+    void start(const std::filesystem::path& directory, CaptureFormat format, uint64_t frameCount);
+    void write(Slot& slot);
+};
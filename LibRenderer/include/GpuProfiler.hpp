@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <vulkan/vulkan_raii.hpp>
+
+enum class GpuPass : uint32_t {
+    eBackground = 0,
+    eGeometry,
+    eBlit,
+    eImGui,
+    eCount,
+};
+
+constexpr uint32_t GPU_PASS_COUNT = static_cast<uint32_t>(GpuPass::eCount);
+
+struct GpuPassStats {
+    float lastMs = 0.f;
+    float minMs = 0.f;
+    float avgMs = 0.f;
+    float p99Ms = 0.f;
+};
+
+/**
+ * Per-pass GPU timings from timestamp queries. Each frame in flight owns a query pool holding a begin/end pair per
+ * pass, results are collected right after the frame's timeline wait so reading them never stalls. The frame resets
+ * its pool with resetQueryPool() before recording any pass.
+ */
+class GpuProfiler {
+   public:
+    static constexpr uint32_t HISTORY_SIZE = 240;
+
+   private:
+    bool     m_supported = false;
+    float    m_timestampPeriod = 1.f;
+    uint64_t m_validMask = 0;
+
+    std::array<std::array<float, HISTORY_SIZE>, GPU_PASS_COUNT> m_history{};
+    std::array<uint32_t, GPU_PASS_COUNT>                        m_historyCount{};
+    std::array<uint32_t, GPU_PASS_COUNT>                        m_historyHead{};
+    std::array<GpuPassStats, GPU_PASS_COUNT>                    m_stats{};
+
+   public:
+    void                init(const vk::raii::PhysicalDevice& gpu, uint32_t queueFamilyIndex);
+    vk::raii::QueryPool createQueryPool(vk::raii::Device& device) const;
+    void                resetQueryPool(vk::CommandBuffer cmd, vk::QueryPool pool) const;
+
+    void beginPass(vk::CommandBuffer cmd, vk::QueryPool pool, GpuPass pass) const;
+    void endPass(vk::CommandBuffer cmd, vk::QueryPool pool, GpuPass pass) const;
+    void collect(const vk::raii::QueryPool& pool);
+
+    bool                isSupported() const { return m_supported; }
+    const GpuPassStats& getStats(GpuPass pass) const { return m_stats[static_cast<uint32_t>(pass)]; }
+    float               getFrameMs() const;
+    static const char*  getPassName(GpuPass pass);
+
+   private:
+    void addSample(uint32_t pass, float ms);
+};
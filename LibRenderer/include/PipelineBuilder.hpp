@@ -20,7 +20,7 @@ class PipelineBuilder {
     PipelineBuilder() { clear(); };
 
     void               clear();
-    vk::raii::Pipeline build(vk::raii::Device& device);
+    vk::raii::Pipeline build(vk::raii::Device& device, vk::Optional<const vk::raii::PipelineCache> cache = nullptr);
     void               setShaders(vk::ShaderModule vertexShader, vk::ShaderModule fragmentShader);
     void               setInputTopology(vk::PrimitiveTopology topology);
     void               setPolygonMode(vk::PolygonMode mode);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <filesystem>
+#include <vulkan/vulkan_raii.hpp>
+
+/**
+ * VkPipelineCache persisted between runs. The blob on disk is prefixed with our own header so a cache written by
+ * another device or driver version is discarded instead of being handed to the driver.
+ */
+class PipelineCache {
+   private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t fileVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t  deviceUUID[VK_UUID_SIZE];
+        uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    static constexpr uint32_t MAGIC = 0x43504b56;  // "VKPC"
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    vk::raii::PipelineCache m_cache = nullptr;
+    std::filesystem::path   m_path;
+    FileHeader              m_expectedHeader{};
+
+   public:
+    void init(vk::raii::Device& device, const vk::raii::PhysicalDevice& gpu, const std::filesystem::path& path);
+    void save() const;
+
+    const vk::raii::PipelineCache& get() const { return m_cache; }
+
+   private:
+    std::vector<uint8_t> loadValidated() const;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+/**
+ * How a pass touches a resource. Each usage maps to the pipeline stages, access mask and, for images, the layout the
+ * graph syncs against.
+ */
+enum class ResourceUsage : uint32_t {
+    eComputeStorageRead = 0,
+    eComputeStorageWrite,
+    eComputeSampled,
+    eFragmentSampled,
+    // clearColorImage in the general layout.
+    eClear,
+    // Loaded and stored, so it reads the previous contents.
+    eColorAttachment,
+    eTransferSrc,
+    eTransferDst,
+    // Buffer only.
+    eVertexStorageRead,
+    eIndirectRead,
+    // Mapped memory read after the frame's timeline value is reached.
+    eHostRead,
+    ePresent,
+};
+
+using RenderGraphResource = uint32_t;
+
+/**
+ * Records a frame as passes that declare how they use images and buffers. execute() culls passes whose writes never
+ * reach an exported resource, derives stage and access masks from each usage and emits at most one batched barrier
+ * before a pass, plus one for the final states of exported resources. Read after read in the same layout costs
+ * nothing.
+ *
+ * Resources are imported with their current layout and the stages of their last use outside the graph, so earlier
+ * submissions on the queue or semaphore waits are chained into the first barrier.
+ */
+class RenderGraph {
+   public:
+    class Pass {
+        friend class RenderGraph;
+
+        struct Access {
+            RenderGraphResource resource;
+            ResourceUsage       usage;
+        };
+
+        std::string                            m_name;
+        std::function<void(vk::CommandBuffer)> m_execute;
+        std::vector<Access>                    m_accesses;
+
+       public:
+        Pass& use(RenderGraphResource resource, ResourceUsage usage);
+
+        const std::string& getName() const { return m_name; }
+    };
+
+   private:
+    struct Resource {
+        vk::Image                 image;
+        vk::ImageSubresourceRange range;
+        vk::Buffer                buffer;
+        vk::DeviceSize            size = 0;
+        bool                      exported = false;
+        ResourceUsage             finalUsage = ResourceUsage::eComputeStorageRead;
+
+        // Sync state while recording.
+        vk::ImageLayout         layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags2 writeStages;
+        vk::AccessFlags2        writeAccess;
+        vk::PipelineStageFlags2 readStages;
+        vk::AccessFlags2        readAccess;
+    };
+
+    std::vector<Pass>     m_passes;
+    std::vector<Resource> m_resources;
+
+    std::vector<vk::ImageMemoryBarrier2>  m_imageBarriers;
+    std::vector<vk::BufferMemoryBarrier2> m_bufferBarriers;
+
+    uint32_t m_culledPassCount = 0;
+    uint32_t m_barrierBatchCount = 0;
+
+   public:
+    /**
+     * Drop all passes and resources. Storage is kept so rebuilding the graph every frame does not allocate.
+     */
+    void reset();
+
+    RenderGraphResource importImage(vk::Image image, vk::ImageLayout layout,
+                                    vk::PipelineStageFlags2 lastStages = vk::PipelineStageFlagBits2::eNone,
+                                    vk::AccessFlags2        lastAccess = vk::AccessFlagBits2::eNone,
+                                    vk::ImageAspectFlags    aspect = vk::ImageAspectFlagBits::eColor);
+    RenderGraphResource importBuffer(vk::Buffer buffer, vk::DeviceSize size = vk::WholeSize,
+                                     vk::PipelineStageFlags2 lastStages = vk::PipelineStageFlagBits2::eNone,
+                                     vk::AccessFlags2        lastAccess = vk::AccessFlagBits2::eNone);
+    /**
+     * Mark the resource as a result of the graph. It is left in the state of finalUsage and keeps its writers alive.
+     */
+    void exportResource(RenderGraphResource resource, ResourceUsage finalUsage);
+
+    /**
+     * The returned reference is only valid until the next addPass().
+     */
+    Pass& addPass(std::string name, std::function<void(vk::CommandBuffer)> execute);
+
+    void execute(vk::CommandBuffer cmd);
+
+    uint32_t getPassCount() const { return static_cast<uint32_t>(m_passes.size()); }
+    uint32_t getCulledPassCount() const { return m_culledPassCount; }
+    uint32_t getBarrierBatchCount() const { return m_barrierBatchCount; }
+
+   private:
+    std::vector<bool> cullPasses() const;
+    void              addBarrier(Resource& resource, ResourceUsage usage);
+    void              flushBarriers(vk::CommandBuffer cmd);
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vulkan/vulkan_raii.hpp>
+
+struct EmbeddedShader {
+    const char*     name;
+    const uint32_t* code;
+    size_t          size;
+};
+
+// Defined by the source generated from cmake/EmbedShaders.cmake when EMBEDDED_SHADERS is set.
+extern const EmbeddedShader EMBEDDED_SHADERS[];
+extern const size_t         EMBEDDED_SHADER_COUNT;
+
+enum class ShaderSource {
+    eEmbedded,
+    eMapped,
+};
+
+/**
+ * Owns every shader module of the engine. SPIR-V comes either from the arrays embedded at build time or from
+ * memory-mapped .spv files, in both cases the words are handed to the driver in place. Modules are keyed by a hash
+ * of their code so identical shaders under different names share one module.
+ */
+class ShaderLibrary {
+   private:
+    vk::raii::Device*                                     m_device = nullptr;
+    ShaderSource                                          m_source = ShaderSource::eMapped;
+    std::string                                           m_directory;
+    std::unordered_map<std::string, uint64_t>             m_nameToHash;
+    std::unordered_map<uint64_t, vk::raii::ShaderModule> m_modules;
+    // Reloaded at runtime, always mapped from the compiled files even when the build embeds shaders.
+    std::unordered_set<std::string> m_reloaded;
+    std::mutex                      m_mutex;
+
+   public:
+    void init(vk::raii::Device& device, ShaderSource source, const std::string& directory);
+
+    /**
+     * Thread safe, the returned handle lives as long as the library.
+     */
+    vk::ShaderModule get(const std::string& name);
+    /**
+     * The next get() of name loads the file again. Modules handed out before stay valid.
+     */
+    void reload(const std::string& name);
+
+    ShaderSource getSource() const { return m_source; }
+    static bool  hasEmbeddedShaders();
+
+   private:
+    vk::ShaderModule createModule(const std::string& name, std::span<const uint32_t> code);
+    vk::ShaderModule loadMapped(const std::string& name);
+    vk::ShaderModule loadEmbedded(const std::string& name);
+};
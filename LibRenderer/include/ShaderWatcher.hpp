@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Watches the GLSL sources and recompiles the ones that change with glslc on its own thread, writing SPIR-V where the
+ * compile_shaders target puts it. Compute shaders also get their bindless variant. Uses inotify on Linux and polls
+ * modification times elsewhere.
+ *
+ * A failed compile leaves the previous SPIR-V in place, the compiler output goes to stderr.
+ */
+class ShaderWatcher {
+   public:
+    static constexpr auto POLL_INTERVAL = std::chrono::milliseconds(250);
+
+   private:
+    std::filesystem::path m_sourceDirectory;
+    std::filesystem::path m_outputDirectory;
+    std::string           m_compiler;
+
+    std::thread       m_thread;
+    std::atomic<bool> m_stopping = false;
+
+    // Names of the .spv files rewritten since the last takeCompiled().
+    std::vector<std::string> m_compiled;
+    std::mutex               m_mutex;
+
+   public:
+    ShaderWatcher() = default;
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+    ~ShaderWatcher() { stop(); }
+
+    void start(const std::filesystem::path& sourceDirectory, const std::filesystem::path& outputDirectory,
+               const std::string& compiler);
+    void stop();
+    bool isRunning() const { return m_thread.joinable(); }
+
+    std::vector<std::string> takeCompiled();
+
+   private:
+    void watchLoop();
+    void compile(const std::string& sourceName);
+    bool runCompiler(const std::filesystem::path& source, const std::string& outputName, const char* define);
+};
@@ -1,21 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <functional>
+#include <future>
 #include <glm/glm.hpp>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
 #include <vulkan/vulkan_raii.hpp>
 
-struct FrameData {
-    vk::raii::CommandBuffer commandBuffer = nullptr;
-    vk::raii::Semaphore     swapchainSemaphore = nullptr;
-    vk::raii::Fence         renderFence = nullptr;
-};
-
-struct AllocatedImage {
-    vk::raii::Image        image = nullptr;
-    vk::raii::ImageView    imageView = nullptr;
-    vk::raii::DeviceMemory imageMemory = nullptr;
-    vk::Extent3D           imageExtent;
-    vk::Format             format;
-};
+#include "Allocator.hpp"
+#include "GpuProfiler.hpp"
 
 struct DescriptorLayoutBuilder {
     std::vector<vk::DescriptorSetLayoutBinding> bindings;
@@ -44,45 +42,195 @@ struct DescriptorLayoutBuilder {
     }
 };
 
+/**
+ * Chains descriptor pools, each one larger than the last, whenever the current pool is exhausted or fragmented. Sets
+ * are never freed one by one: clearPools() resets every pool wholesale, which is how the per-frame instances recycle
+ * their sets once the frame has completed.
+ */
 struct DescriptorAllocator {
     struct PoolSizeRatio {
         vk::DescriptorType type;
         float              ratio;
     };
 
-    vk::raii::DescriptorPool pool = nullptr;
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
 
-    void initPool(vk::raii::Device& device, uint32_t maxSet, std::span<PoolSizeRatio> poolSizeSpan) {
-        std::vector<vk::DescriptorPoolSize> poolSizes(poolSizeSpan.size());
-        size_t                              i = 0;
-        for(const auto& size : poolSizeSpan) {
-            poolSizes[i++] = vk::DescriptorPoolSize{
-                .type = size.type,
-                .descriptorCount = uint32_t(size.ratio * maxSet),
-            };
-        }
+    std::vector<PoolSizeRatio>            ratios;
+    std::vector<vk::raii::DescriptorPool> fullPools;
+    std::vector<vk::raii::DescriptorPool> readyPools;
+    uint32_t                              setsPerPool = 0;
 
-        vk::DescriptorPoolCreateInfo poolInfo{
-            .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-            .maxSets = maxSet,
-            .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
-            .pPoolSizes = poolSizes.data(),
-        };
-        pool = vk::raii::DescriptorPool(device, poolInfo);
+    void init(vk::raii::Device& device, uint32_t initialSets, std::span<const PoolSizeRatio> poolRatios) {
+        ratios.assign(poolRatios.begin(), poolRatios.end());
+        fullPools.clear();
+        readyPools.clear();
+        readyPools.push_back(createPool(device, initialSets));
+        setsPerPool = std::min(initialSets * 2, MAX_SETS_PER_POOL);
+    }
+
+    void clearPools() {
+        for(auto& pool : readyPools) {
+            pool.reset();
+        }
+        for(auto& pool : fullPools) {
+            pool.reset();
+            readyPools.push_back(std::move(pool));
+        }
+        fullPools.clear();
     }
 
-    void clearDescriptorSets(vk::Device device) { device.resetDescriptorPool(pool); }
+    vk::DescriptorSet allocate(vk::raii::Device& device, vk::DescriptorSetLayout layout) {
+        auto pool = takePool(device);
 
-    vk::raii::DescriptorSet allocate(vk::raii::Device& device, vk::DescriptorSetLayout layout) {
         vk::DescriptorSetAllocateInfo allocInfo{
             .descriptorPool = pool,
             .descriptorSetCount = 1,
             .pSetLayouts = &layout,
         };
+        vk::DescriptorSet set;
+        try {
+            // Released from the RAII wrapper, the set lives until its pool is reset.
+            set = device.allocateDescriptorSets(allocInfo).front().release();
+        } catch(const vk::SystemError& error) {
+            if(error.code() != vk::Result::eErrorOutOfPoolMemory && error.code() != vk::Result::eErrorFragmentedPool) {
+                throw;
+            }
+            fullPools.push_back(std::move(pool));
+            pool = takePool(device);
+            allocInfo.descriptorPool = pool;
+            set = device.allocateDescriptorSets(allocInfo).front().release();
+        }
+        readyPools.push_back(std::move(pool));
+        return set;
+    }
+
+   private:
+    vk::raii::DescriptorPool takePool(vk::raii::Device& device) {
+        if(!readyPools.empty()) {
+            auto pool = std::move(readyPools.back());
+            readyPools.pop_back();
+            return pool;
+        }
+        auto pool = createPool(device, setsPerPool);
+        setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+        return pool;
+    }
+
+    vk::raii::DescriptorPool createPool(vk::raii::Device& device, uint32_t setCount) {
+        std::vector<vk::DescriptorPoolSize> poolSizes;
+        for(const auto& ratio : ratios) {
+            poolSizes.push_back(vk::DescriptorPoolSize{
+                .type = ratio.type,
+                .descriptorCount = static_cast<uint32_t>(ratio.ratio * setCount),
+            });
+        }
+
+        vk::DescriptorPoolCreateInfo poolInfo{
+            .maxSets = setCount,
+            .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+            .pPoolSizes = poolSizes.data(),
+        };
+        return vk::raii::DescriptorPool(device, poolInfo);
+    }
+};
+
+struct AllocatedImage {
+    Allocation          allocation;
+    vk::raii::Image     image = nullptr;
+    vk::raii::ImageView imageView = nullptr;
+    vk::Extent3D        imageExtent;
+    vk::Format          format;
+};
+
+/**
+ * Parts of a frame recorded into their own secondary command buffer, possibly on a worker thread.
+ */
+enum class RecordJob : uint32_t { eBackground, eGeometry, eCount };
 
-        auto descriptorSets = device.allocateDescriptorSets(allocInfo);
-        return std::move(descriptorSets.front());
+constexpr uint32_t RECORD_JOB_COUNT = static_cast<uint32_t>(RecordJob::eCount);
+
+struct FrameData {
+    vk::raii::CommandBuffer commandBuffer = nullptr;
+    vk::raii::Semaphore     swapchainSemaphore = nullptr;
+    vk::raii::QueryPool     queryPool = nullptr;
+    // One transient pool per record job, a pool is only ever touched by the thread recording that job.
+    std::vector<vk::raii::CommandPool>   recordPools;
+    std::vector<vk::raii::CommandBuffer> recordCommandBuffers;
+    // Async compute only, the background is shaded on the compute queue.
+    vk::raii::CommandBuffer computeCommandBuffer = nullptr;
+    // The background is shaded here and copied into the draw image. It keeps its contents between uses, so it is
+    // only shaded again when backgroundKey no longer matches the effect inputs. Without reuse on the graphics queue
+    // the effect writes the draw image directly and this image is left alone.
+    AllocatedImage backgroundImage;
+    uint32_t       backgroundImageIndex = ~0u;
+    uint64_t       backgroundKey = 0;
+    bool           backgroundDirty = true;
+    bool           backgroundDirect = false;
+    // Reset as soon as the frame's timeline value is reached, the sets below are reallocated every frame.
+    DescriptorAllocator descriptors;
+    vk::DescriptorSet   backgroundDescriptorSet;
+    vk::DescriptorSet   drawImageDescriptorSet;
+    // Frame timeline value signaled by the last submission that used this frame's resources.
+    uint64_t timelineValue = 0;
+};
+
+/**
+ * Resources retired while frames may still use them. Each entry is tagged with the number of frames submitted when it
+ * was retired and destroyed once that many frames have completed on the GPU.
+ */
+struct DeletionQueue {
+    std::deque<std::pair<uint64_t, std::shared_ptr<void>>> entries;
+
+    template <typename T>
+    void push(uint64_t retireFrame, T&& resource) {
+        entries.emplace_back(retireFrame, std::make_shared<std::decay_t<T>>(std::forward<T>(resource)));
     }
+
+    void flush(uint64_t completedFrames) {
+        while(!entries.empty() && entries.front().first <= completedFrames) {
+            entries.pop_front();
+        }
+    }
+
+    void clear() { entries.clear(); }
+};
+
+struct AllocatedBuffer {
+    Allocation        allocation;
+    vk::raii::Buffer  buffer = nullptr;
+    vk::DeviceSize    size = 0;
+    vk::DeviceAddress address = 0;
+};
+
+/**
+ * Layouts shared with mesh.vert, which pulls vertices and per-object data through buffer device addresses.
+ */
+struct Vertex {
+    glm::vec4 position;
+    glm::vec4 color;
+};
+
+struct ObjectData {
+    glm::mat4 transform;
+    glm::vec4 color;
+};
+
+struct MeshPushConstants {
+    glm::mat4         viewProj;
+    vk::DeviceAddress vertexBuffer;
+    vk::DeviceAddress objectBuffer;
+};
+
+/**
+ * Geometry drawn with a single drawIndexedIndirectCount. Each indirect command's firstInstance indexes objectBuffer.
+ */
+struct MeshScene {
+    AllocatedBuffer vertexBuffer;
+    AllocatedBuffer indexBuffer;
+    AllocatedBuffer objectBuffer;
+    AllocatedBuffer indirectBuffer;
+    AllocatedBuffer countBuffer;
+    uint32_t        maxDrawCount = 0;
 };
 
 struct ComputePushConstants {
@@ -90,11 +238,81 @@ struct ComputePushConstants {
     glm::vec4 data2;
     glm::vec4 data3;
     glm::vec4 data4;
+
+    bool operator==(const ComputePushConstants&) const = default;
 };
 
 struct ComputeEffect {
     const char*          name;
+    const char*          shader;
     vk::raii::Pipeline   pipeline = nullptr;
     vk::PipelineLayout   layout;
     ComputePushConstants data;
-};
\ No newline at end of file
+    // Specialization constants 0 and 1 of the shader.
+    vk::Extent2D workgroupSize = {.width = 16, .height = 16};
+};
+
+enum class CaptureFormat : uint32_t { ePng, eExr, eRaw };
+
+/**
+ * Settings edited by the GUI, handed to the thread that draws and applied at its next frame boundary.
+ */
+struct FrameSettings {
+    vk::Extent2D                      windowExtent;
+    vk::PresentModeKHR                presentMode = vk::PresentModeKHR::eFifo;
+    uint32_t                          framesInFlight = 2;
+    int                               backgroundEffect = 0;
+    std::vector<ComputePushConstants> effectData;
+    bool                              parallelRecording = true;
+    bool                              incrementalBackground = true;
+    bool                              dynamicResolution = false;
+    float                             targetFrameMs = 1000.f / 60.f;
+    float                             minRenderScale = 0.5f;
+    bool                              recording = false;
+    CaptureFormat                     captureFormat = CaptureFormat::ePng;
+    // Bumped for every screenshot requested through the GUI.
+    uint32_t screenshotCount = 0;
+};
+
+/**
+ * What the GUI shows about the last drawn frame, handed back by the thread that draws.
+ */
+struct FrameStats {
+    vk::PresentModeKHR                                     presentMode = vk::PresentModeKHR::eFifo;
+    vk::Extent2D                                           renderExtent;
+    float                                                  renderScale = 1.f;
+    bool                                                   backgroundReused = false;
+    uint32_t                                               passCount = 0;
+    uint32_t                                               culledPassCount = 0;
+    uint32_t                                               barrierBatchCount = 0;
+    std::array<GpuPassStats, GPU_PASS_COUNT>               gpuPasses{};
+    float                                                  gpuFrameMs = 0.f;
+    uint64_t                                               capturedFrames = 0;
+    uint64_t                                               droppedCaptures = 0;
+    std::vector<MemoryHeapStats>                           memoryHeaps;
+    std::array<MemoryCategoryStats, MEMORY_CATEGORY_COUNT> memoryCategories{};
+};
+
+struct PipelineJobResult {
+    vk::raii::Pipeline pipeline = nullptr;
+    float              compileMs = 0.f;
+};
+
+/**
+ * A pipeline compiling on a worker, moved into target once the main thread sees it finished.
+ */
+struct PendingPipeline {
+    std::string                    name;
+    vk::raii::Pipeline*            target;
+    std::future<PipelineJobResult> future;
+};
+
+/**
+ * How to build a pipeline again when one of its shaders is recompiled.
+ */
+struct ReloadablePipeline {
+    std::string                         name;
+    vk::raii::Pipeline*                 target;
+    std::vector<std::string>            shaders;
+    std::function<vk::raii::Pipeline()> build;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed set of worker threads draining a FIFO of jobs. Pending jobs are still run on destruction.
+ */
+class ThreadPool {
+   private:
+    std::vector<std::thread>          m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_condition;
+    bool                              m_stopping = false;
+
+   public:
+    explicit ThreadPool(uint32_t threadCount = getDefaultThreadCount());
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    template <typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+        using Result = std::invoke_result_t<F>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        auto future = packaged->get_future();
+        {
+            std::lock_guard lock(m_mutex);
+            m_tasks.emplace_back([packaged] { (*packaged)(); });
+        }
+        m_condition.notify_one();
+        return future;
+    }
+
+    uint32_t        getThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+    static uint32_t getDefaultThreadCount();
+
+   private:
+    void workerLoop();
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+/**
+ * Scoped CPU zones for the frame loop. VKR_TRACE_ZONE("name") times the rest of the enclosing scope,
+ * VKR_TRACE_THREAD_NAME("name") labels the calling thread's track. Both compile to nothing unless the library is
+ * configured with VKR_ENABLE_TRACING, zone names must be string literals.
+ */
+#ifdef VKR_ENABLE_TRACING
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Writes zones in the Chrome trace event format, which chrome://tracing and ui.perfetto.dev both open. Every thread
+ * records into its own single producer ring, so a zone costs two clock reads and a store without locking. A
+ * background thread drains the rings into the file while tracing is on. Zones are dropped, and counted, when a ring
+ * fills faster than it is drained.
+ */
+class Tracer {
+   public:
+    static constexpr uint32_t RING_CAPACITY = 1 << 14;
+    static constexpr auto     FLUSH_INTERVAL = std::chrono::milliseconds(20);
+
+   private:
+    struct Event {
+        const char* name;
+        uint64_t    startNs;
+        uint64_t    durationNs;
+    };
+
+    struct ThreadRing {
+        std::array<Event, RING_CAPACITY> events;
+        // Advanced by the owning thread.
+        std::atomic<uint64_t> head = 0;
+        // Advanced by whoever drains, the flusher while tracing and start()/stop() otherwise.
+        std::atomic<uint64_t>    tail = 0;
+        std::atomic<const char*> name = nullptr;
+        uint32_t                 threadId = 0;
+        bool                     nameWritten = false;
+    };
+
+    const std::chrono::steady_clock::time_point m_epoch = std::chrono::steady_clock::now();
+    std::atomic<bool>                           m_enabled = false;
+    std::atomic<uint64_t>                       m_droppedCount = 0;
+
+    // Rings are never freed, so a thread exiting mid-flush leaves nothing dangling.
+    std::vector<std::unique_ptr<ThreadRing>> m_rings;
+    std::mutex                               m_ringsMutex;
+
+    std::mutex        m_controlMutex;
+    std::ofstream     m_file;
+    bool              m_firstEvent = true;
+    std::thread       m_flusher;
+    std::atomic<bool> m_stopping = false;
+
+   public:
+    static Tracer& get();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+    ~Tracer() { stop(); }
+
+    /**
+     * Zones recorded before start() are discarded. Returns false when the file cannot be opened.
+     */
+    bool start(const std::filesystem::path& path);
+    void stop();
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+    }
+    void record(const char* name, uint64_t startNs, uint64_t endNs);
+    void setThreadName(const char* name);
+
+   private:
+    Tracer() = default;
+
+    ThreadRing& getThreadRing();
+    void        flushLoop();
+    void        drain();
+};
+
+class TraceZone {
+   private:
+    const char* m_name;
+    uint64_t    m_start = 0;
+    bool        m_active;
+
+   public:
+    explicit TraceZone(const char* name) : m_name(name), m_active(Tracer::get().isEnabled()) {
+        if(m_active) {
+            m_start = Tracer::get().now();
+        }
+    }
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+    ~TraceZone() {
+        if(m_active) {
+            Tracer::get().record(m_name, m_start, Tracer::get().now());
+        }
+    }
+};
+
+#define VKR_TRACE_CONCAT_IMPL(a, b) a##b
+#define VKR_TRACE_CONCAT(a, b)      VKR_TRACE_CONCAT_IMPL(a, b)
+#define VKR_TRACE_ZONE(name)        TraceZone VKR_TRACE_CONCAT(traceZone, __LINE__)(name)
+#define VKR_TRACE_THREAD_NAME(name) Tracer::get().setThreadName(name)
+
+#else
+
+#define VKR_TRACE_ZONE(name)        ((void)0)
+#define VKR_TRACE_THREAD_NAME(name) ((void)0)
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Lock-free single producer, single consumer handoff of the latest value. The producer fills back() and publishes
+ * it, the consumer calls update() and reads front(). Neither side ever waits: values published faster than they are
+ * consumed are skipped, and front() stays on the last value while nothing new arrives.
+ *
+ * Slots are reused, so back() still holds an older value after publish() and has to be written in full.
+ */
+template <typename T>
+class TripleBuffer {
+   private:
+    // Set on the shared slot index while it holds a value the consumer has not taken yet.
+    static constexpr uint8_t FRESH_BIT = 0x4;
+    static constexpr uint8_t INDEX_MASK = 0x3;
+
+    std::array<T, 3>     m_slots{};
+    uint8_t              m_back = 0;
+    std::atomic<uint8_t> m_shared = 1;
+    uint8_t              m_front = 2;
+
+   public:
+    T&   back() { return m_slots[m_back]; }
+    void publish() { m_back = m_shared.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK; }
+
+    /**
+     * Returns true when front() moved to a newly published value.
+     */
+    bool update() {
+        if(!(m_shared.load(std::memory_order_relaxed) & FRESH_BIT)) {
+            return false;
+        }
+        m_front = m_shared.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+    T& front() { return m_slots[m_front]; }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "Allocator.hpp"
+#include "Structs.hpp"
+
+/**
+ * Streams data into device-local buffers from a persistently mapped staging ring. Copies are recorded into a batch
+ * and submitted together on flush(), completion is tracked with a timeline semaphore so uploads overlap rendering;
+ * consumers wait on the value returned for their data instead of idling the queue.
+ *
+ * Destination buffers must be shared between the transfer and graphics queue families, see
+ * Engine::createDeviceBuffer(). Images are not streamed, they would need a queue family ownership transfer.
+ *
+ * Uploads may be queued from any thread. Queueing submits the batch itself when the ring fills up, so without a
+ * dedicated transfer queue init() takes the mutex every submit and present to the shared queue must hold.
+ */
+class UploadManager {
+   public:
+    static constexpr vk::DeviceSize DEFAULT_RING_SIZE = 32ull * 1024 * 1024;
+    static constexpr vk::DeviceSize COPY_ALIGNMENT = 16;
+
+   private:
+    struct Batch {
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        uint64_t                timelineValue = 0;
+        uint64_t                ringEnd = 0;
+        // Staging for uploads larger than the ring, freed once the batch completes.
+        std::vector<AllocatedBuffer> oversizeStaging;
+    };
+
+    vk::raii::Device*     m_device = nullptr;
+    DeviceAllocator*      m_allocator = nullptr;
+    vk::raii::Queue       m_queue = nullptr;
+    uint32_t              m_queueFamilyIndex = 0;
+    std::mutex*           m_queueMutex = nullptr;
+    vk::raii::CommandPool m_commandPool = nullptr;
+    vk::raii::Semaphore   m_timeline = nullptr;
+
+    AllocatedBuffer m_ring;
+    std::byte*      m_ringData = nullptr;
+    // Monotonic byte counters, the ring offset is the counter modulo the ring size.
+    uint64_t m_ringHead = 0;
+    uint64_t m_ringTail = 0;
+
+    Batch                                m_recording;
+    std::deque<Batch>                    m_inFlight;
+    std::vector<vk::raii::CommandBuffer> m_freeCommandBuffers;
+    uint64_t                             m_submittedValue = 0;
+    std::mutex                           m_mutex;
+
+   public:
+    UploadManager() = default;
+    UploadManager(const UploadManager&) = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+
+    /**
+     * queueMutex guards queue when other code submits to it as well, null when the queue is used only here.
+     */
+    void init(vk::raii::Device& device, DeviceAllocator& allocator, vk::raii::Queue queue, uint32_t queueFamilyIndex,
+              std::mutex* queueMutex, vk::DeviceSize ringSize = DEFAULT_RING_SIZE);
+
+    /**
+     * Queue a copy into dst. The data is staged immediately and may be freed by the caller on return.
+     */
+    void uploadBuffer(const AllocatedBuffer& dst, const void* data, vk::DeviceSize size, vk::DeviceSize dstOffset = 0);
+
+    /**
+     * Submit everything queued so far. Returns the timeline value signaled once it has landed, which is also the
+     * latest submitted value when nothing was pending.
+     */
+    uint64_t flush();
+    bool     isComplete(uint64_t value) const { return m_timeline.getCounterValue() >= value; }
+    void     wait(uint64_t value);
+
+    vk::Semaphore getTimeline() const { return m_timeline; }
+    uint32_t      getQueueFamilyIndex() const { return m_queueFamilyIndex; }
+
+   private:
+    vk::CommandBuffer beginRecording();
+    vk::DeviceSize    stage(const void* data, vk::DeviceSize size, vk::Buffer& outBuffer);
+    uint64_t          submit();
+    void              reclaim(bool waitForOldest);
+};
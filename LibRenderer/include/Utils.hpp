@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <span>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
@@ -15,7 +16,10 @@
 
 namespace utils {
     uint32_t findMemoryTypeIndex(vk::PhysicalDevice gpu, uint32_t typeFilter, vk::MemoryPropertyFlags properties);
-    vk::raii::ShaderModule loadShaderModule(const char* filePath, vk::raii::Device& device);
+    uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+    inline uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
 }  // namespace utils
 
 namespace imageUtils {
@@ -42,9 +46,11 @@ namespace vkStructsUtils {
         };
     }
 
-    inline vk::SemaphoreSubmitInfo makeSemaphoreSubmitInfo(vk::PipelineStageFlags2 stageMask, vk::Semaphore semaphore) {
+    inline vk::SemaphoreSubmitInfo makeSemaphoreSubmitInfo(vk::PipelineStageFlags2 stageMask, vk::Semaphore semaphore,
+                                                           uint64_t value = 0) {
         return vk::SemaphoreSubmitInfo{
             .semaphore = semaphore,
+            .value = value,
             .stageMask = stageMask,
         };
     }
@@ -61,6 +67,19 @@ namespace vkStructsUtils {
         };
     }
 
+    inline vk::SubmitInfo2 makeSubmitInfo(vk::CommandBufferSubmitInfo*             cmd,
+                                          std::span<const vk::SemaphoreSubmitInfo> signalSemaphores,
+                                          std::span<const vk::SemaphoreSubmitInfo> waitSemaphores) {
+        return vk::SubmitInfo2{
+            .waitSemaphoreInfoCount = static_cast<uint32_t>(waitSemaphores.size()),
+            .pWaitSemaphoreInfos = waitSemaphores.data(),
+            .signalSemaphoreInfoCount = static_cast<uint32_t>(signalSemaphores.size()),
+            .pSignalSemaphoreInfos = signalSemaphores.data(),
+            .commandBufferInfoCount = 1,
+            .pCommandBufferInfos = cmd,
+        };
+    }
+
     inline vk::ImageCreateInfo makeImageCreateInfo(vk::Format format, vk::ImageUsageFlags usage, vk::Extent3D extent) {
         return vk::ImageCreateInfo{
             .imageType = vk::ImageType::e2D,
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+/**
+ * Tuned compute workgroup sizes persisted between runs as plain text, one line per device and effect:
+ * "vendorID deviceID driverVersion effect x y". Entries of other devices are kept when saving, so one file serves
+ * every GPU the engine ran on.
+ */
+class WorkgroupSizeCache {
+   private:
+    struct Entry {
+        uint32_t     vendorID;
+        uint32_t     deviceID;
+        uint32_t     driverVersion;
+        std::string  effect;
+        vk::Extent2D size;
+    };
+
+    std::filesystem::path m_path;
+    std::vector<Entry>    m_entries;
+    uint32_t              m_vendorID = 0;
+    uint32_t              m_deviceID = 0;
+    uint32_t              m_driverVersion = 0;
+
+   public:
+    void init(const vk::raii::PhysicalDevice& gpu, const std::filesystem::path& path);
+    void save() const;
+
+    std::optional<vk::Extent2D> find(const std::string& effect) const;
+    void                        store(const std::string& effect, vk::Extent2D size);
+    void                        clear();
+
+   private:
+    bool isCurrentDevice(const Entry& entry) const;
+};
@@ -0,0 +1,341 @@
+#include "../include/Allocator.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "../include/Structs.hpp"
+#include "../include/Utils.hpp"
+
+Allocation::Allocation(Allocation&& other) noexcept
+    : m_allocator(std::exchange(other.m_allocator, nullptr)),
+      m_block(std::exchange(other.m_block, nullptr)),
+      m_offset(other.m_offset),
+      m_size(other.m_size),
+      m_category(other.m_category) {}
+
+Allocation& Allocation::operator=(Allocation&& other) noexcept {
+    if(this != &other) {
+        release();
+        m_allocator = std::exchange(other.m_allocator, nullptr);
+        m_block = std::exchange(other.m_block, nullptr);
+        m_offset = other.m_offset;
+        m_size = other.m_size;
+        m_category = other.m_category;
+    }
+    return *this;
+}
+
+Allocation::~Allocation() { release(); }
+
+void Allocation::release() {
+    if(m_allocator && m_block) {
+        m_allocator->free(*this);
+    }
+    m_allocator = nullptr;
+    m_block = nullptr;
+}
+
+vk::DeviceMemory Allocation::getMemory() const { return m_block ? *m_block->memory : vk::DeviceMemory{}; }
+
+void* Allocation::getMappedData() const {
+    if(!m_block || !m_block->mapped) {
+        return nullptr;
+    }
+    return static_cast<char*>(m_block->mapped) + m_offset;
+}
+
+void DeviceAllocator::init(const vk::raii::PhysicalDevice& gpu, vk::raii::Device& device, bool bufferDeviceAddress,
+                           bool memoryBudget) {
+    m_device = &device;
+    m_gpu = &gpu;
+    m_bufferDeviceAddress = bufferDeviceAddress;
+    m_memoryBudget = memoryBudget;
+    m_memoryProperties = gpu.getMemoryProperties();
+    m_bufferImageGranularity = gpu.getProperties().limits.bufferImageGranularity;
+}
+
+std::vector<uint32_t> DeviceAllocator::findMemoryTypes(uint32_t typeFilter, MemoryUsage usage) const {
+    vk::MemoryPropertyFlags required;
+    vk::MemoryPropertyFlags preferred;
+    switch(usage) {
+        case MemoryUsage::eGpuOnly:
+            required = vk::MemoryPropertyFlagBits::eDeviceLocal;
+            break;
+        case MemoryUsage::eCpuToGpu:
+            required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+            break;
+        case MemoryUsage::eGpuToCpu:
+            required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+            preferred = vk::MemoryPropertyFlagBits::eHostCached;
+            break;
+    }
+
+    std::vector<uint32_t> candidates;
+    for(uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+        if((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & required) == required) {
+            candidates.push_back(i);
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+        bool aPreferred = (m_memoryProperties.memoryTypes[a].propertyFlags & preferred) == preferred;
+        bool bPreferred = (m_memoryProperties.memoryTypes[b].propertyFlags & preferred) == preferred;
+        return aPreferred && !bPreferred;
+    });
+    return candidates;
+}
+
+vk::DeviceSize DeviceAllocator::getBlockSize(uint32_t memoryTypeIndex) const {
+    auto heapIndex = m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    // Small heaps (e.g. a 256MB BAR window) get proportionally smaller blocks.
+    return std::min(DEFAULT_BLOCK_SIZE, m_memoryProperties.memoryHeaps[heapIndex].size / 8);
+}
+
+MemoryBlock& DeviceAllocator::createBlock(uint32_t memoryTypeIndex, vk::DeviceSize size, bool linear,
+                                          bool dedicated) {
+    vk::MemoryAllocateFlagsInfo flagsInfo{
+        .flags = vk::MemoryAllocateFlagBits::eDeviceAddress,
+    };
+    vk::MemoryAllocateInfo allocInfo{
+        .pNext = m_bufferDeviceAddress ? &flagsInfo : nullptr,
+        .allocationSize = size,
+        .memoryTypeIndex = memoryTypeIndex,
+    };
+
+    auto block = std::make_unique<MemoryBlock>();
+    block->memory = vk::raii::DeviceMemory(*m_device, allocInfo);
+    block->size = size;
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->linear = linear;
+    block->dedicated = dedicated;
+    if(m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+        block->mapped = block->memory.mapMemory(0, VK_WHOLE_SIZE);
+    }
+    if(!dedicated) {
+        block->freeRanges.emplace(0, size);
+    }
+
+    m_blocks.push_back(std::move(block));
+    return *m_blocks.back();
+}
+
+bool DeviceAllocator::tryAllocateFromBlock(MemoryBlock& block, vk::DeviceSize size, vk::DeviceSize alignment,
+                                           vk::DeviceSize& outOffset) {
+    auto           best = block.freeRanges.end();
+    vk::DeviceSize bestOffset = 0;
+    vk::DeviceSize bestWaste = ~0ull;
+
+    for(auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it) {
+        vk::DeviceSize aligned = (it->first + alignment - 1) / alignment * alignment;
+        vk::DeviceSize padding = aligned - it->first;
+        if(it->second < padding + size) {
+            continue;
+        }
+        vk::DeviceSize waste = it->second - size;
+        if(waste < bestWaste) {
+            best = it;
+            bestOffset = aligned;
+            bestWaste = waste;
+        }
+    }
+    if(best == block.freeRanges.end()) {
+        return false;
+    }
+
+    vk::DeviceSize rangeStart = best->first;
+    vk::DeviceSize rangeEnd = best->first + best->second;
+    block.freeRanges.erase(best);
+    if(bestOffset > rangeStart) {
+        block.freeRanges.emplace(rangeStart, bestOffset - rangeStart);
+    }
+    if(rangeEnd > bestOffset + size) {
+        block.freeRanges.emplace(bestOffset + size, rangeEnd - bestOffset - size);
+    }
+    outOffset = bestOffset;
+    return true;
+}
+
+Allocation DeviceAllocator::allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage,
+                                     MemoryCategory category, bool linear) {
+    std::lock_guard lock(m_mutex);
+
+    // With a granularity of 1 buffers and images can be neighbours, otherwise they get separate blocks.
+    bool separateKinds = m_bufferImageGranularity > 1;
+
+    auto makeAllocation = [&](MemoryBlock& block, vk::DeviceSize offset) {
+        block.usedBytes += requirements.size;
+        block.allocationCount++;
+        auto& categoryStats = m_categoryStats[static_cast<uint32_t>(category)];
+        categoryStats.bytes += requirements.size;
+        categoryStats.allocationCount++;
+
+        Allocation allocation;
+        allocation.m_allocator = this;
+        allocation.m_block = &block;
+        allocation.m_offset = offset;
+        allocation.m_size = requirements.size;
+        allocation.m_category = category;
+        return allocation;
+    };
+
+    for(auto memoryTypeIndex : findMemoryTypes(requirements.memoryTypeBits, usage)) {
+        auto blockSize = getBlockSize(memoryTypeIndex);
+        try {
+            if(requirements.size > blockSize / 2) {
+                return makeAllocation(createBlock(memoryTypeIndex, requirements.size, linear, true), 0);
+            }
+
+            vk::DeviceSize offset = 0;
+            for(auto& block : m_blocks) {
+                if(block->memoryTypeIndex != memoryTypeIndex || block->dedicated ||
+                   (separateKinds && block->linear != linear)) {
+                    continue;
+                }
+                if(tryAllocateFromBlock(*block, requirements.size, requirements.alignment, offset)) {
+                    return makeAllocation(*block, offset);
+                }
+            }
+
+            auto& block = createBlock(memoryTypeIndex, blockSize, linear, false);
+            if(tryAllocateFromBlock(block, requirements.size, requirements.alignment, offset)) {
+                return makeAllocation(block, offset);
+            }
+        } catch(const vk::OutOfDeviceMemoryError&) {
+            // Heap is full, fall through to the next compatible memory type.
+        }
+    }
+    throw std::runtime_error("failed to allocate device memory!");
+}
+
+void DeviceAllocator::free(Allocation& allocation) {
+    std::lock_guard lock(m_mutex);
+
+    MemoryBlock* block = allocation.m_block;
+    block->usedBytes -= allocation.m_size;
+    block->allocationCount--;
+    auto& categoryStats = m_categoryStats[static_cast<uint32_t>(allocation.m_category)];
+    categoryStats.bytes -= allocation.m_size;
+    categoryStats.allocationCount--;
+
+    if(!block->dedicated) {
+        auto it = block->freeRanges.emplace(allocation.m_offset, allocation.m_size).first;
+        auto next = std::next(it);
+        if(next != block->freeRanges.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            block->freeRanges.erase(next);
+        }
+        if(it != block->freeRanges.begin()) {
+            auto prev = std::prev(it);
+            if(prev->first + prev->second == it->first) {
+                prev->second += it->second;
+                block->freeRanges.erase(it);
+            }
+        }
+    }
+
+    if(block->allocationCount != 0) {
+        return;
+    }
+
+    // Dedicated blocks go away immediately, regular blocks only when another empty one of the same kind is kept.
+    bool release = block->dedicated;
+    for(const auto& other : m_blocks) {
+        if(other.get() != block && !other->dedicated && other->allocationCount == 0 &&
+           other->memoryTypeIndex == block->memoryTypeIndex && other->linear == block->linear) {
+            release = true;
+            break;
+        }
+    }
+    if(release) {
+        std::erase_if(m_blocks, [&](const auto& b) { return b.get() == block; });
+    }
+}
+
+AllocatedImage DeviceAllocator::createImage(const vk::ImageCreateInfo& imageInfo, MemoryUsage usage,
+                                            MemoryCategory category, vk::ImageAspectFlags aspectFlags) {
+    AllocatedImage newImage;
+    newImage.format = imageInfo.format;
+    newImage.imageExtent = imageInfo.extent;
+    newImage.image = vk::raii::Image(*m_device, imageInfo);
+    newImage.allocation = allocate(newImage.image.getMemoryRequirements(), usage, category,
+                                   imageInfo.tiling == vk::ImageTiling::eLinear);
+    newImage.image.bindMemory(newImage.allocation.getMemory(), newImage.allocation.getOffset());
+
+    auto imageViewCreateInfo = vkStructsUtils::makeImageViewCreateInfo(newImage.format, newImage.image, aspectFlags);
+    newImage.imageView = vk::raii::ImageView(*m_device, imageViewCreateInfo);
+    return newImage;
+}
+
+AllocatedBuffer DeviceAllocator::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, MemoryUsage memoryUsage,
+                                              MemoryCategory category, std::span<const uint32_t> queueFamilies) {
+    AllocatedBuffer newBuffer;
+    newBuffer.size = size;
+
+    vk::BufferCreateInfo bufferInfo{
+        .size = size,
+        .usage = usage,
+        .sharingMode = vk::SharingMode::eExclusive,
+    };
+    if(queueFamilies.size() > 1) {
+        bufferInfo.sharingMode = vk::SharingMode::eConcurrent;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
+    newBuffer.buffer = vk::raii::Buffer(*m_device, bufferInfo);
+    newBuffer.allocation = allocate(newBuffer.buffer.getMemoryRequirements(), memoryUsage, category, true);
+    newBuffer.buffer.bindMemory(newBuffer.allocation.getMemory(), newBuffer.allocation.getOffset());
+    if(usage & vk::BufferUsageFlagBits::eShaderDeviceAddress) {
+        newBuffer.address = m_device->getBufferAddress(vk::BufferDeviceAddressInfo{.buffer = newBuffer.buffer});
+    }
+    return newBuffer;
+}
+
+std::vector<MemoryHeapStats> DeviceAllocator::getHeapStats() const {
+    std::vector<MemoryHeapStats> stats(m_memoryProperties.memoryHeapCount);
+    for(uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++) {
+        stats[i].heapSize = m_memoryProperties.memoryHeaps[i].size;
+        stats[i].budget = stats[i].heapSize;
+    }
+    if(m_memoryBudget) {
+        auto properties = m_gpu->getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2,
+                                                      vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        const auto& budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        for(uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++) {
+            stats[i].budget = budget.heapBudget[i];
+            stats[i].usage = budget.heapUsage[i];
+        }
+    }
+
+    std::lock_guard lock(m_mutex);
+    for(const auto& block : m_blocks) {
+        auto& heapStats = stats[m_memoryProperties.memoryTypes[block->memoryTypeIndex].heapIndex];
+        heapStats.blockBytes += block->size;
+        heapStats.usedBytes += block->usedBytes;
+        heapStats.blockCount++;
+        heapStats.allocationCount += block->allocationCount;
+    }
+    if(!m_memoryBudget) {
+        for(auto& heapStats : stats) {
+            heapStats.usage = heapStats.blockBytes;
+        }
+    }
+    return stats;
+}
+
+std::array<MemoryCategoryStats, MEMORY_CATEGORY_COUNT> DeviceAllocator::getCategoryStats() const {
+    std::lock_guard lock(m_mutex);
+    return m_categoryStats;
+}
+
+const char* DeviceAllocator::getCategoryName(MemoryCategory category) {
+    switch(category) {
+        case MemoryCategory::eRenderTarget:
+            return "render targets";
+        case MemoryCategory::eBuffer:
+            return "buffers";
+        case MemoryCategory::eStaging:
+            return "staging";
+        case MemoryCategory::eReadback:
+            return "readback";
+    }
+    return "unknown";
+}
@@ -0,0 +1,82 @@
+#include "../include/BatchRenderer.hpp"
+
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+
+#include "../include/ThreadPool.hpp"
+#include "../include/Tracer.hpp"
+
+BatchRenderer::BatchRenderer(const std::vector<const char*>& extensions, vk::Extent2D extent, uint32_t maxDevices) {
+    // Ranking needs an instance, the first engine provides it and then takes the best device.
+    auto first = std::make_unique<Engine>(extensions, std::vector<const char*>{});
+    for(const auto& candidate : first->rankDevices()) {
+        if(candidate.suitable && m_devices.size() < maxDevices) {
+            m_devices.push_back(candidate);
+        }
+    }
+    if(m_devices.empty()) {
+        throw std::runtime_error("no suitable GPU found!");
+    }
+
+    for(const auto& device : m_devices) {
+        auto engine = m_engines.empty() ? std::move(first)
+                                        : std::make_unique<Engine>(extensions, std::vector<const char*>{});
+        // Instances may enumerate devices in different orders, the UUID names the same device in all of them and
+        // tells identical GPUs apart.
+        engine->setDevicePreference(device.uuid);
+        std::filesystem::path cachePath = PIPELINE_CACHE_PATH;
+        cachePath.replace_filename(cachePath.stem().string() + "_" + device.uuid + cachePath.extension().string());
+        engine->setPipelineCachePath(cachePath);
+        engine->initHeadless(extent);
+        engine->waitForPipelines();
+        m_engines.push_back(std::move(engine));
+    }
+    std::cout << "batch rendering on " << m_engines.size() << " device(s).\n";
+}
+
+void BatchRenderer::render(uint64_t frameCount, const FrameSetup& setup, const FrameOutput& output) {
+    std::atomic<uint64_t> nextFrame = 0;
+    m_deviceFrameCounts.assign(m_engines.size(), 0);
+
+    std::vector<std::future<void>> results;
+    ThreadPool                     threads(getDeviceCount());
+    for(uint32_t device = 0; device < getDeviceCount(); device++) {
+        results.push_back(threads.submit([&, device] {
+            Engine& engine = *m_engines[device];
+            try {
+                for(uint64_t frame = nextFrame++; frame < frameCount; frame = nextFrame++) {
+                    VKR_TRACE_ZONE("batch frame");
+                    setup(engine, frame);
+                    engine.drawOffscreen();
+                    if(output) {
+                        output(frame, device, engine.readbackDrawImage());
+                    }
+                    m_deviceFrameCounts[device]++;
+                }
+                engine.waitIdle();
+            } catch(...) {
+                // Keep the other devices from taking more frames.
+                nextFrame = frameCount;
+                throw;
+            }
+        }));
+    }
+
+    std::exception_ptr error;
+    for(auto& result : results) {
+        try {
+            result.get();
+        } catch(...) {
+            if(!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,176 @@
+#include "../include/BindlessTable.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    constexpr std::array<vk::DescriptorType, BINDLESS_TYPE_COUNT> DESCRIPTOR_TYPES = {
+        vk::DescriptorType::eStorageImage,
+        vk::DescriptorType::eSampledImage,
+        vk::DescriptorType::eStorageBuffer,
+    };
+}  // namespace
+
+bool BindlessTable::isSupported(const vk::PhysicalDeviceVulkan12Features& features) {
+    return features.descriptorIndexing && features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound &&
+           features.descriptorBindingUpdateUnusedWhilePending &&
+           features.descriptorBindingStorageImageUpdateAfterBind &&
+           features.descriptorBindingSampledImageUpdateAfterBind &&
+           features.descriptorBindingStorageBufferUpdateAfterBind;
+}
+
+void BindlessTable::enableFeatures(vk::PhysicalDeviceVulkan12Features& features) {
+    features.descriptorIndexing = true;
+    features.runtimeDescriptorArray = true;
+    features.descriptorBindingPartiallyBound = true;
+    features.descriptorBindingUpdateUnusedWhilePending = true;
+    features.descriptorBindingStorageImageUpdateAfterBind = true;
+    features.descriptorBindingSampledImageUpdateAfterBind = true;
+    features.descriptorBindingStorageBufferUpdateAfterBind = true;
+}
+
+void BindlessTable::init(vk::raii::Device& device, const vk::raii::PhysicalDevice& gpu) {
+    m_device = &device;
+
+    auto properties = gpu.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+    const auto& limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+    m_bindings[static_cast<uint32_t>(BindlessType::eStorageImage)].capacity =
+        std::min({DEFAULT_CAPACITY, limits.maxDescriptorSetUpdateAfterBindStorageImages,
+                  limits.maxPerStageDescriptorUpdateAfterBindStorageImages});
+    m_bindings[static_cast<uint32_t>(BindlessType::eSampledImage)].capacity =
+        std::min({DEFAULT_CAPACITY, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                  limits.maxPerStageDescriptorUpdateAfterBindSampledImages});
+    m_bindings[static_cast<uint32_t>(BindlessType::eStorageBuffer)].capacity =
+        std::min({DEFAULT_CAPACITY, limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                  limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+    std::array<vk::DescriptorSetLayoutBinding, BINDLESS_TYPE_COUNT> bindings;
+    std::array<vk::DescriptorBindingFlags, BINDLESS_TYPE_COUNT>     bindingFlags;
+    std::array<vk::DescriptorPoolSize, BINDLESS_TYPE_COUNT>         poolSizes;
+    for(uint32_t i = 0; i < BINDLESS_TYPE_COUNT; i++) {
+        bindings[i] = vk::DescriptorSetLayoutBinding{
+            .binding = i,
+            .descriptorType = DESCRIPTOR_TYPES[i],
+            .descriptorCount = m_bindings[i].capacity,
+            .stageFlags = vk::ShaderStageFlagBits::eAll,
+        };
+        // Slots are filled while earlier frames using other slots are still executing.
+        bindingFlags[i] = vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                          vk::DescriptorBindingFlagBits::ePartiallyBound |
+                          vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+        poolSizes[i] = vk::DescriptorPoolSize{
+            .type = DESCRIPTOR_TYPES[i],
+            .descriptorCount = m_bindings[i].capacity,
+        };
+    }
+
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
+        .bindingCount = BINDLESS_TYPE_COUNT,
+        .pBindingFlags = bindingFlags.data(),
+    };
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{
+        .pNext = &bindingFlagsInfo,
+        .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+        .bindingCount = BINDLESS_TYPE_COUNT,
+        .pBindings = bindings.data(),
+    };
+    m_layout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+    vk::DescriptorPoolCreateInfo poolInfo{
+        .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+        .maxSets = 1,
+        .poolSizeCount = BINDLESS_TYPE_COUNT,
+        .pPoolSizes = poolSizes.data(),
+    };
+    m_pool = vk::raii::DescriptorPool(device, poolInfo);
+
+    vk::DescriptorSetAllocateInfo allocInfo{
+        .descriptorPool = m_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &*m_layout,
+    };
+    // Lives as long as the pool, which is never reset.
+    m_set = device.allocateDescriptorSets(allocInfo).front().release();
+}
+
+uint32_t BindlessTable::addStorageImage(vk::ImageView imageView) {
+    std::lock_guard         lock(m_mutex);
+    uint32_t                index = acquire(BindlessType::eStorageImage);
+    vk::DescriptorImageInfo imageInfo{
+        .imageView = imageView,
+        .imageLayout = vk::ImageLayout::eGeneral,
+    };
+    write(BindlessType::eStorageImage, index, &imageInfo, nullptr);
+    return index;
+}
+
+uint32_t BindlessTable::addSampledImage(vk::ImageView imageView, vk::ImageLayout layout) {
+    std::lock_guard         lock(m_mutex);
+    uint32_t                index = acquire(BindlessType::eSampledImage);
+    vk::DescriptorImageInfo imageInfo{
+        .imageView = imageView,
+        .imageLayout = layout,
+    };
+    write(BindlessType::eSampledImage, index, &imageInfo, nullptr);
+    return index;
+}
+
+uint32_t BindlessTable::addStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range) {
+    std::lock_guard          lock(m_mutex);
+    uint32_t                 index = acquire(BindlessType::eStorageBuffer);
+    vk::DescriptorBufferInfo bufferInfo{
+        .buffer = buffer,
+        .offset = offset,
+        .range = range,
+    };
+    write(BindlessType::eStorageBuffer, index, nullptr, &bufferInfo);
+    return index;
+}
+
+void BindlessTable::retire(BindlessType type, uint32_t index, uint64_t retireFrame) {
+    if(index == INVALID_INDEX) {
+        return;
+    }
+    std::lock_guard lock(m_mutex);
+    m_retired.emplace_back(retireFrame, type, index);
+}
+
+void BindlessTable::collect(uint64_t completedFrames) {
+    std::lock_guard lock(m_mutex);
+    while(!m_retired.empty() && std::get<0>(m_retired.front()) <= completedFrames) {
+        auto [frame, type, index] = m_retired.front();
+        m_bindings[static_cast<uint32_t>(type)].freeIndices.push_back(index);
+        m_retired.pop_front();
+    }
+}
+
+void BindlessTable::bind(vk::CommandBuffer cmd, vk::PipelineBindPoint bindPoint, vk::PipelineLayout layout) const {
+    cmd.bindDescriptorSets(bindPoint, layout, 0, m_set, nullptr);
+}
+
+uint32_t BindlessTable::acquire(BindlessType type) {
+    auto& binding = m_bindings[static_cast<uint32_t>(type)];
+    if(!binding.freeIndices.empty()) {
+        uint32_t index = binding.freeIndices.back();
+        binding.freeIndices.pop_back();
+        return index;
+    }
+    if(binding.next == binding.capacity) {
+        throw std::runtime_error("Bindless table is full!");
+    }
+    return binding.next++;
+}
+
+void BindlessTable::write(BindlessType type, uint32_t index, const vk::DescriptorImageInfo* imageInfo,
+                          const vk::DescriptorBufferInfo* bufferInfo) {
+    vk::WriteDescriptorSet descriptorWrite{
+        .dstSet = m_set,
+        .dstBinding = static_cast<uint32_t>(type),
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = DESCRIPTOR_TYPES[static_cast<uint32_t>(type)],
+        .pImageInfo = imageInfo,
+        .pBufferInfo = bufferInfo,
+    };
+    m_device->updateDescriptorSets(descriptorWrite, {});
+}
@@ -0,0 +1,181 @@
+#include "../include/DeviceSelector.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    uint64_t getTypeScore(vk::PhysicalDeviceType type) {
+        switch(type) {
+            case vk::PhysicalDeviceType::eDiscreteGpu:
+                return 40000;
+            case vk::PhysicalDeviceType::eIntegratedGpu:
+                return 30000;
+            case vk::PhysicalDeviceType::eVirtualGpu:
+                return 20000;
+            case vk::PhysicalDeviceType::eCpu:
+                return 10000;
+            default:
+                return 0;
+        }
+    }
+
+    std::string formatUuid(const vk::ArrayWrapper1D<uint8_t, VK_UUID_SIZE>& uuid) {
+        std::ostringstream out;
+        out << std::hex << std::setfill('0');
+        for(uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+            if(i == 4 || i == 6 || i == 8 || i == 10) {
+                out << '-';
+            }
+            out << std::setw(2) << static_cast<uint32_t>(uuid[i]);
+        }
+        return out.str();
+    }
+
+    std::string normalize(const std::string& text, bool stripDashes) {
+        std::string result;
+        for(char c : text) {
+            if(!(stripDashes && c == '-')) {
+                result += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+        }
+        return result;
+    }
+}  // namespace
+
+DeviceCandidate DeviceSelector::evaluate(const vk::raii::PhysicalDevice& gpu, uint32_t index, vk::SurfaceKHR surface) {
+    auto properties = gpu.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+    const auto& deviceProperties = properties.get<vk::PhysicalDeviceProperties2>().properties;
+
+    DeviceCandidate candidate{
+        .index = index,
+        .name = deviceProperties.deviceName.data(),
+        .uuid = formatUuid(properties.get<vk::PhysicalDeviceIDProperties>().deviceUUID),
+        .type = deviceProperties.deviceType,
+    };
+    auto unsuitable = [&](const std::string& reason) {
+        candidate.unsuitableReason = reason;
+        return candidate;
+    };
+
+    auto memoryProperties = gpu.getMemoryProperties();
+    for(uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if(memoryProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+            candidate.deviceLocalBytes = std::max(candidate.deviceLocalBytes, memoryProperties.memoryHeaps[i].size);
+        }
+    }
+
+    // The same queue family choices as Engine::get*QueueFamilyIndex().
+    auto     queueFamilies = gpu.getQueueFamilyProperties();
+    uint32_t graphicsFamily = UINT32_MAX;
+    for(uint32_t i = 0; i < queueFamilies.size(); i++) {
+        auto flags = queueFamilies[i].queueFlags;
+        if((flags & vk::QueueFlagBits::eGraphics) && graphicsFamily == UINT32_MAX) {
+            graphicsFamily = i;
+        }
+        if((flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics)) {
+            candidate.asyncCompute = true;
+        }
+        if((flags & vk::QueueFlagBits::eTransfer) &&
+           !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))) {
+            candidate.dedicatedTransfer = true;
+        }
+    }
+
+    candidate.score = getTypeScore(candidate.type) + candidate.deviceLocalBytes / DEVICE_LOCAL_BYTES_PER_POINT +
+                      (candidate.asyncCompute ? ASYNC_COMPUTE_SCORE : 0) +
+                      (candidate.dedicatedTransfer ? DEDICATED_TRANSFER_SCORE : 0);
+
+    if(deviceProperties.apiVersion < VK_API_VERSION_1_3) {
+        return unsuitable("Vulkan 1.3 unsupported");
+    }
+    if(graphicsFamily == UINT32_MAX) {
+        return unsuitable("no graphics queue");
+    }
+
+    // Keep in sync with the features and extensions Engine::initVulkan() enables unconditionally.
+    auto features = gpu.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features,
+                                     vk::PhysicalDeviceVulkan13Features>();
+    const auto& features12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+    const auto& features13 = features.get<vk::PhysicalDeviceVulkan13Features>();
+    if(!features.get<vk::PhysicalDeviceFeatures2>().features.drawIndirectFirstInstance ||
+       !features12.drawIndirectCount || !features12.timelineSemaphore || !features12.bufferDeviceAddress ||
+       !features13.dynamicRendering || !features13.synchronization2) {
+        return unsuitable("missing required features");
+    }
+
+    std::vector<const char*> requiredExtensions = {vk::KHRSynchronization2ExtensionName};
+    if(surface) {
+        requiredExtensions.push_back(vk::KHRSwapchainExtensionName);
+    }
+    auto extensions = gpu.enumerateDeviceExtensionProperties();
+    for(const char* required : requiredExtensions) {
+        bool found = std::ranges::any_of(extensions, [&](const vk::ExtensionProperties& ext) {
+            return std::strcmp(ext.extensionName, required) == 0;
+        });
+        if(!found) {
+            return unsuitable(std::string("missing ") + required);
+        }
+    }
+    if(surface && !gpu.getSurfaceSupportKHR(graphicsFamily, surface)) {
+        return unsuitable("cannot present to the surface");
+    }
+
+    candidate.suitable = true;
+    return candidate;
+}
+
+std::vector<DeviceCandidate> DeviceSelector::rank(const std::vector<vk::raii::PhysicalDevice>& gpus,
+                                                  vk::SurfaceKHR                               surface) {
+    std::vector<DeviceCandidate> candidates;
+    for(uint32_t i = 0; i < gpus.size(); i++) {
+        candidates.push_back(evaluate(gpus[i], i, surface));
+    }
+    // Stable, so equally scored devices keep the enumeration order.
+    std::ranges::stable_sort(candidates, [](const DeviceCandidate& a, const DeviceCandidate& b) {
+        if(a.suitable != b.suitable) {
+            return a.suitable;
+        }
+        return a.score > b.score;
+    });
+    return candidates;
+}
+
+bool DeviceSelector::matches(const DeviceCandidate& candidate, const std::string& preference) {
+    if(!preference.empty() && std::ranges::all_of(preference, [](char c) { return std::isdigit(c); })) {
+        return candidate.index == std::stoul(preference);
+    }
+    if(normalize(candidate.uuid, true) == normalize(preference, true)) {
+        return true;
+    }
+    return normalize(candidate.name, false).find(normalize(preference, false)) != std::string::npos;
+}
+
+const DeviceCandidate& DeviceSelector::select(const std::vector<DeviceCandidate>& candidates,
+                                              const std::string&                  preference) {
+    for(const auto& candidate : candidates) {
+        if(candidate.suitable && (preference.empty() || matches(candidate, preference))) {
+            return candidate;
+        }
+    }
+    if(preference.empty()) {
+        throw std::runtime_error("no suitable GPU found!");
+    }
+    throw std::runtime_error("no suitable GPU matches " + preference + "!");
+}
+
+void DeviceSelector::print(const std::vector<DeviceCandidate>& candidates) {
+    for(const auto& candidate : candidates) {
+        std::cout << "device " << candidate.index << ": " << candidate.name << " (" << vk::to_string(candidate.type)
+                  << ", " << candidate.deviceLocalBytes / (1024 * 1024) << " MB, " << candidate.uuid << ")";
+        if(candidate.suitable) {
+            std::cout << ", score " << candidate.score << ".\n";
+        } else {
+            std::cout << ", unsuitable: " << candidate.unsuitableReason << ".\n";
+        }
+    }
+}
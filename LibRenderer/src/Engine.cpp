@@ -2,25 +2,62 @@
 
 #include <math.h>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
+#include <limits>
 
 #include "../include/PipelineBuilder.hpp"
 
-Engine::Engine(const std::vector<const char*>& extensions, const std::vector<const char*>& layers) {
+// Where GUI recordings and screenshots go, relative to the working directory.
+constexpr const char* CAPTURE_DIRECTORY = "captures";
+// How often the render thread checks whether a minimized window came back.
+constexpr auto MINIMIZED_POLL_INTERVAL = std::chrono::milliseconds(10);
+
+Engine::Engine(const std::vector<const char*>& extensions, const std::vector<const char*>& layers)
+    : m_pipelineCachePath(PIPELINE_CACHE_PATH), m_workgroupCachePath(WORKGROUP_CACHE_PATH) {
     vk::ApplicationInfo appInfo{
         .pEngineName = "SWAY",
         .engineVersion = VK_MAKE_VERSION(1, 0, 0),
         .apiVersion = VK_MAKE_VERSION(1, 3, 0),
     };
 
+    // Portability enumeration is only valid when the extension is enabled, headless Linux setups don't ask for it.
+    bool portability = std::any_of(extensions.begin(), extensions.end(), [](const char* ext) {
+        return std::strcmp(ext, vk::KHRPortabilityEnumerationExtensionName) == 0;
+    });
+
+    // VK_EXT_swapchain_maintenance1 needs its surface counterpart, added whenever surfaces are requested.
+    std::vector<const char*> instanceExtensions = extensions;
+    auto isRequested = [&](const char* name) {
+        return std::ranges::any_of(instanceExtensions, [&](const char* ext) { return std::strcmp(ext, name) == 0; });
+    };
+    auto availableExtensions = m_context.enumerateInstanceExtensionProperties();
+    auto isAvailable = [&](const char* name) {
+        return std::ranges::any_of(availableExtensions, [&](const vk::ExtensionProperties& ext) {
+            return std::strcmp(ext.extensionName, name) == 0;
+        });
+    };
+    if(isRequested(vk::KHRSurfaceExtensionName) && isAvailable(vk::EXTSurfaceMaintenance1ExtensionName) &&
+       isAvailable(vk::KHRGetSurfaceCapabilities2ExtensionName)) {
+        for(const char* name : {vk::KHRGetSurfaceCapabilities2ExtensionName, vk::EXTSurfaceMaintenance1ExtensionName}) {
+            if(!isRequested(name)) {
+                instanceExtensions.push_back(name);
+            }
+        }
+        m_surfaceMaintenance1 = true;
+    }
+
     vk::InstanceCreateInfo instanceInfo{
-        .flags = vk::InstanceCreateFlagBits::eEnumeratePortabilityKHR,
+        .flags = portability ? vk::InstanceCreateFlagBits::eEnumeratePortabilityKHR : vk::InstanceCreateFlags{},
         .pApplicationInfo = &appInfo,
         .enabledLayerCount = static_cast<uint32_t>(layers.size()),
         .ppEnabledLayerNames = layers.data(),
-        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
-        .ppEnabledExtensionNames = extensions.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(instanceExtensions.size()),
+        .ppEnabledExtensionNames = instanceExtensions.data(),
     };
     m_instance = vk::raii::Instance(m_context, instanceInfo);
 
@@ -28,9 +65,24 @@ Engine::Engine(const std::vector<const char*>& extensions, const std::vector<con
 }
 
 Engine::~Engine() {
-    m_device.waitIdle();
+    stopRenderThread();
+    for(auto& pending : m_pendingPipelines) {
+        pending.future.wait();
+    }
+    if(*m_device) {
+        m_device.waitIdle();
+        // Idle queues can still have presents pending, their fences must signal before they are destroyed.
+        for(const auto& fence : m_presentFences) {
+            VK_CHECK(m_device.waitForFences(*fence, vk::True, UINT64_MAX));
+        }
+        m_pipelineCache.save();
+        // Everything submitted has completed, write the frames still waiting for the timeline.
+        m_frameCapture.collect(UINT64_MAX);
+    }
 #ifndef VK_USE_PLATFORM_METAL_EXT
-    ImGui_ImplVulkan_Shutdown();
+    if(ImGui::GetCurrentContext()) {
+        ImGui_ImplVulkan_Shutdown();
+    }
 #endif
 }
 
@@ -42,40 +94,138 @@ void Engine::initWithSurface(VkSurfaceKHR surface) {
 }
 #endif
 
+void Engine::initHeadless(vk::Extent2D extent) {
+    m_headlessExtent = extent;
+    std::cout << "init headless " << extent.width << "x" << extent.height << ".\n";
+    initVulkan();
+}
+
+std::vector<DeviceCandidate> Engine::rankDevices() const {
+    return DeviceSelector::rank(m_instance.enumeratePhysicalDevices(), *m_surface);
+}
+
 void Engine::initVulkan() {
     auto gpus = m_instance.enumeratePhysicalDevices();
-    m_chosenGPU = std::move(gpus[0]);
-
-    vk::StructureChain<vk::PhysicalDeviceVulkan13Features> featureChain{
-        {.dynamicRendering = true, .synchronization2 = true},
-    };
+    auto candidates = DeviceSelector::rank(gpus, *m_surface);
+    DeviceSelector::print(candidates);
+    const DeviceCandidate& chosen = DeviceSelector::select(candidates, m_devicePreference);
+    m_chosenGPU = std::move(gpus[chosen.index]);
+    std::cout << "chosen device: " << chosen.name << ".\n";
+
+    vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features,
+                       vk::PhysicalDeviceVulkan13Features, vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>
+        featureChain;
+    featureChain.get<vk::PhysicalDeviceFeatures2>().features.drawIndirectFirstInstance = true;
+    auto& features12 = featureChain.get<vk::PhysicalDeviceVulkan12Features>();
+    features12.drawIndirectCount = true;
+    features12.timelineSemaphore = true;
+    features12.bufferDeviceAddress = true;
+
+    auto supported =
+        m_chosenGPU.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    m_bindless = m_bindlessRequested && BindlessTable::isSupported(supported.get<vk::PhysicalDeviceVulkan12Features>());
+    if(m_bindless) {
+        BindlessTable::enableFeatures(features12);
+    }
+    auto& features13 = featureChain.get<vk::PhysicalDeviceVulkan13Features>();
+    features13.dynamicRendering = true;
+    features13.synchronization2 = true;
 
     auto graphicsQueueIndex = getGraphicsQueueFamilyIndex();
+    auto computeQueueIndex = getComputeQueueFamilyIndex();
+    auto transferQueueIndex = getTransferQueueFamilyIndex();
+    m_asyncCompute = computeQueueIndex != graphicsQueueIndex;
 
-    float                     queuePriority = 0.0;
-    vk::DeviceQueueCreateInfo queueInfo{
+    float                                  queuePriority = 0.0;
+    std::vector<vk::DeviceQueueCreateInfo> queueInfos{{
         .queueFamilyIndex = graphicsQueueIndex,
         .queueCount = 1,
         .pQueuePriorities = &queuePriority,
-    };
-    std::array deviceExtensions = {vk::KHRSwapchainExtensionName, vk::KHRSynchronization2ExtensionName,
-                                   "VK_KHR_portability_subset"};
+    }};
+    if(m_asyncCompute) {
+        queueInfos.push_back({
+            .queueFamilyIndex = computeQueueIndex,
+            .queueCount = 1,
+            .pQueuePriorities = &queuePriority,
+        });
+    }
+    if(transferQueueIndex != graphicsQueueIndex) {
+        queueInfos.push_back({
+            .queueFamilyIndex = transferQueueIndex,
+            .queueCount = 1,
+            .pQueuePriorities = &queuePriority,
+        });
+    }
+    std::vector<const char*> deviceExtensions = {vk::KHRSynchronization2ExtensionName};
+    if(*m_surface) {
+        deviceExtensions.push_back(vk::KHRSwapchainExtensionName);
+    }
+    for(const auto& ext : m_chosenGPU.enumerateDeviceExtensionProperties()) {
+        if(std::strcmp(ext.extensionName, "VK_KHR_portability_subset") == 0) {
+            deviceExtensions.push_back("VK_KHR_portability_subset");
+        }
+        if(std::strcmp(ext.extensionName, vk::EXTMemoryBudgetExtensionName) == 0) {
+            deviceExtensions.push_back(vk::EXTMemoryBudgetExtensionName);
+            m_memoryBudget = true;
+        }
+        if(*m_surface && m_surfaceMaintenance1 &&
+           std::strcmp(ext.extensionName, vk::EXTSwapchainMaintenance1ExtensionName) == 0) {
+            auto features = m_chosenGPU.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                     vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>();
+            m_swapchainMaintenance1 =
+                features.get<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>().swapchainMaintenance1;
+        }
+    }
+    if(m_swapchainMaintenance1) {
+        deviceExtensions.push_back(vk::EXTSwapchainMaintenance1ExtensionName);
+        featureChain.get<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>().swapchainMaintenance1 = true;
+    } else {
+        featureChain.unlink<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>();
+    }
 
     vk::DeviceCreateInfo deviceInfo{
         .pNext = featureChain.get(),
-        .queueCreateInfoCount = 1,
-        .pQueueCreateInfos = &queueInfo,
+        .queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size()),
+        .pQueueCreateInfos = queueInfos.data(),
         .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
         .ppEnabledExtensionNames = deviceExtensions.data(),
     };
     m_device = vk::raii::Device(m_chosenGPU, deviceInfo);
     m_graphicsQueue = m_device.getQueue(graphicsQueueIndex, 0);
-
-    createSwapchain();
-    initFrameDatas();
+    m_computeQueue = m_device.getQueue(computeQueueIndex, 0);
+    std::cout << "async compute: " << (m_asyncCompute ? "on" : "off") << ".\n";
+    std::cout << "memory budget: " << (m_memoryBudget ? "on" : "off") << ".\n";
+    std::cout << "present fences: " << (m_swapchainMaintenance1 ? "on" : "off") << ".\n";
+    m_allocator.init(m_chosenGPU, m_device, true, m_memoryBudget);
+    m_frameCapture.init(m_allocator);
+    m_uploadManager.init(m_device, m_allocator, m_device.getQueue(transferQueueIndex, 0), transferQueueIndex,
+                         transferQueueIndex == graphicsQueueIndex ? &m_graphicsQueueMutex : nullptr);
+    m_pipelineCache.init(m_device, m_chosenGPU, m_pipelineCachePath);
+    m_workgroupSizeCache.init(m_chosenGPU, m_workgroupCachePath);
+    m_shaderLibrary.init(m_device, m_shaderSource, SHADER_DIR);
+    if(m_shaderHotReload) {
+        m_shaderWatcher.start(SHADER_SOURCE_DIR, SHADER_DIR, GLSL_COMPILER_PATH);
+    }
+    if(m_bindless) {
+        m_bindlessTable.init(m_device, m_chosenGPU);
+    }
+    std::cout << "bindless: " << (m_bindless ? "on" : "off") << ".\n";
+
+    if(*m_surface) {
+        createSwapchain();
+        createDrawImage(m_swapchainExtent);
+        m_swapchainDirty = false;
+    } else {
+        createDrawImage(m_headlessExtent);
+    }
+    initImmediateSubmit();
     initDescriptors();
+    initFrameDatas(m_requestedFramesInFlight);
     initComputePipeline();
     initTrianglePipeline();
+    initMeshPipeline();
+    initMeshScene();
+    initGuiSettings();
 }
 
 uint32_t Engine::getGraphicsQueueFamilyIndex() {
@@ -90,10 +240,66 @@ uint32_t Engine::getGraphicsQueueFamilyIndex() {
     throw std::runtime_error("No graphics queue found!");
 }
 
+uint32_t Engine::getComputeQueueFamilyIndex() {
+    auto     queueFamilyProperties = m_chosenGPU.getQueueFamilyProperties();
+    uint32_t idx{0};
+    for(const auto& prop : queueFamilyProperties) {
+        if((prop.queueFlags & vk::QueueFlagBits::eCompute) && !(prop.queueFlags & vk::QueueFlagBits::eGraphics)) {
+            return idx;
+        }
+        ++idx;
+    }
+    // No async compute, share the graphics queue.
+    return getGraphicsQueueFamilyIndex();
+}
+
+uint32_t Engine::getTransferQueueFamilyIndex() {
+    auto     queueFamilyProperties = m_chosenGPU.getQueueFamilyProperties();
+    uint32_t idx{0};
+    for(const auto& prop : queueFamilyProperties) {
+        if((prop.queueFlags & vk::QueueFlagBits::eTransfer) &&
+           !(prop.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))) {
+            return idx;
+        }
+        ++idx;
+    }
+    // No DMA queue, uploads go through the graphics queue in submission order.
+    return getGraphicsQueueFamilyIndex();
+}
+
+AllocatedBuffer Engine::createDeviceBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage) {
+    std::vector<uint32_t> queueFamilies = {getGraphicsQueueFamilyIndex()};
+    if(m_uploadManager.getQueueFamilyIndex() != queueFamilies[0]) {
+        queueFamilies.push_back(m_uploadManager.getQueueFamilyIndex());
+    }
+    return m_allocator.createBuffer(size, usage | vk::BufferUsageFlagBits::eTransferDst, MemoryUsage::eGpuOnly,
+                                    MemoryCategory::eBuffer, queueFamilies);
+}
+
+void Engine::addFrameWaits(std::vector<vk::SemaphoreSubmitInfo>& waitInfos, uint64_t frameValue) {
+    if(m_asyncCompute) {
+        waitInfos.push_back(vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eAllTransfer,
+                                                                    m_computeTimeline, frameValue));
+    }
+    // Everything queued for upload before this frame lands before any of its commands run.
+    uint64_t uploadValue = m_uploadManager.flush();
+    if(uploadValue > 0) {
+        waitInfos.push_back(vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eAllCommands,
+                                                                    m_uploadManager.getTimeline(), uploadValue));
+    }
+}
+
 void Engine::createSwapchain() {
     const auto surfaceCapabilities = m_chosenGPU.getSurfaceCapabilitiesKHR(*m_surface);
     const auto surfaceFormats = m_chosenGPU.getSurfaceFormatsKHR(*m_surface);
     m_swapchainExtent = surfaceCapabilities.currentExtent;
+    if(m_swapchainExtent.width == UINT32_MAX) {
+        // The surface size is defined by the swapchain, take it from the window.
+        m_swapchainExtent.width = std::clamp(m_windowExtent.width, surfaceCapabilities.minImageExtent.width,
+                                             surfaceCapabilities.maxImageExtent.width);
+        m_swapchainExtent.height = std::clamp(m_windowExtent.height, surfaceCapabilities.minImageExtent.height,
+                                              surfaceCapabilities.maxImageExtent.height);
+    }
 
     m_swapchainImageFormat = surfaceFormats[0];
     for(const auto& surfaceFormat : surfaceFormats) {
@@ -104,9 +310,15 @@ void Engine::createSwapchain() {
         }
     }
 
+    uint32_t minImageCount = std::max(3u, surfaceCapabilities.minImageCount);
+    if(surfaceCapabilities.maxImageCount != 0) {
+        minImageCount = std::min(minImageCount, surfaceCapabilities.maxImageCount);
+    }
+    m_presentMode = choosePresentMode();
+
     vk::SwapchainCreateInfoKHR swapchainInfo{
         .surface = *m_surface,
-        .minImageCount = std::max(3u, surfaceCapabilities.minImageCount),
+        .minImageCount = minImageCount,
         .imageFormat = m_swapchainImageFormat.format,
         .imageColorSpace = m_swapchainImageFormat.colorSpace,
         .imageExtent = m_swapchainExtent,
@@ -114,13 +326,25 @@ void Engine::createSwapchain() {
         .imageUsage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst,
         .imageSharingMode = vk::SharingMode::eExclusive,
         .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
-        .presentMode = vk::PresentModeKHR::eFifo,
+        .presentMode = m_presentMode,
         .clipped = true,
+        .oldSwapchain = *m_swapchain,
     };
-    m_swapchain = vk::raii::SwapchainKHR(m_device, swapchainInfo);
-    m_swapchainImages.clear();
+    vk::raii::SwapchainKHR newSwapchain(m_device, swapchainInfo);
+
+    // The frame timeline only covers the GPU work, presents of the old swapchain may still wait on its render
+    // semaphores. Views go first so they are destroyed before the swapchain owning their images.
+    if(*m_swapchain) {
+        m_retiredSwapchains.push(m_presentCount, std::move(m_swapchainImageViews));
+        m_retiredSwapchains.push(m_presentCount, std::move(m_swapchainRenderSemaphores));
+        m_retiredSwapchains.push(m_presentCount, std::move(m_swapchain));
+    }
+    m_swapchain = std::move(newSwapchain);
     m_swapchainImages = m_swapchain.getImages();
+    m_swapchainImagesAcquired.assign(m_swapchainImages.size(), false);
+    m_swapchainPresentCount = m_presentCount;
     m_swapchainImageViews.clear();
+    m_swapchainRenderSemaphores.clear();
 
     vk::ImageViewCreateInfo imageViewInfo{
         .viewType = vk::ImageViewType::e2D,
@@ -137,118 +361,363 @@ void Engine::createSwapchain() {
     for(const auto& img : m_swapchainImages) {
         imageViewInfo.image = img;
         m_swapchainImageViews.emplace_back(m_device, imageViewInfo);
+        m_swapchainRenderSemaphores.emplace_back(m_device, vk::SemaphoreCreateInfo{});
     }
 
-    m_drawImage.format = vk::Format::eR16G16B16A16Sfloat,
-    m_drawImage.imageExtent = {.width = m_swapchainExtent.width, .height = m_swapchainExtent.height, .depth = 1};
+    std::cout << "Success to create swapchain " << m_swapchainExtent.width << "x" << m_swapchainExtent.height << " ("
+              << vk::to_string(m_presentMode) << ").\n";
+}
 
-    auto imageCreateInfo = vkStructsUtils::makeImageCreateInfo(
-        m_drawImage.format,
-        vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eStorage |
-            vk::ImageUsageFlagBits::eColorAttachment,
-        m_drawImage.imageExtent);
-    m_drawImage.image = vk::raii::Image(m_device, imageCreateInfo);
+bool Engine::recreateSwapchain() {
+    const auto surfaceCapabilities = m_chosenGPU.getSurfaceCapabilitiesKHR(*m_surface);
+    if(surfaceCapabilities.currentExtent.width == 0 || surfaceCapabilities.currentExtent.height == 0) {
+        // Minimized, keep the old swapchain until the window comes back.
+        m_minimized = true;
+        return false;
+    }
+    m_minimized = false;
 
-    auto                   memRequirements = m_drawImage.image.getMemoryRequirements();
-    vk::MemoryAllocateInfo allocInfo{
-        .allocationSize = memRequirements.size,
-        .memoryTypeIndex = utils::findMemoryTypeIndex(m_chosenGPU, memRequirements.memoryTypeBits,
-                                                      vk::MemoryPropertyFlagBits::eDeviceLocal),
+    createSwapchain();
+    if(m_swapchainExtent != getDrawExtent()) {
+        m_deletionQueue.push(m_frameNumber, std::move(m_drawImage));
+        createDrawImage(m_swapchainExtent);
+        createBackgroundImages();
+        // beginFrame() already wrote the current frame's sets for the images that were just retired.
+        if(!m_bindless) {
+            auto& frame = getCurrentFame();
+            frame.backgroundDescriptorSet = allocateStorageImageSet(frame, frame.backgroundImage.imageView);
+            frame.drawImageDescriptorSet = allocateStorageImageSet(frame, m_drawImage.imageView);
+        }
+    }
+    m_swapchainDirty = false;
+    return true;
+}
+
+void Engine::collectRetiredSwapchains(uint32_t acquiredImageIndex) {
+    if(m_swapchainMaintenance1) {
+        while(!m_presentFences.empty() && m_presentFences.front().getStatus() == vk::Result::eSuccess) {
+            m_freePresentFences.push_back(std::move(m_presentFences.front()));
+            m_presentFences.pop_front();
+            m_completedPresents++;
+        }
+    } else {
+        // An image comes back through acquire only after its last present finished, once all images of the new
+        // swapchain did, the presents queued to the old ones are taken as done.
+        m_swapchainImagesAcquired[acquiredImageIndex] = true;
+        if(std::find(m_swapchainImagesAcquired.begin(), m_swapchainImagesAcquired.end(), false) ==
+           m_swapchainImagesAcquired.end()) {
+            m_completedPresents = m_swapchainPresentCount;
+        }
+    }
+    auto& entries = m_retiredSwapchains.entries;
+    while(!entries.empty() && entries.front().first <= m_completedPresents) {
+        // Frames recorded before the swapchain was replaced may still be running.
+        m_deletionQueue.push(m_frameNumber, std::move(entries.front().second));
+        entries.pop_front();
+    }
+}
+
+vk::PresentModeKHR Engine::choosePresentMode() const {
+    auto supportedModes = m_chosenGPU.getSurfacePresentModesKHR(*m_surface);
+    auto isSupported = [&](vk::PresentModeKHR mode) {
+        return std::find(supportedModes.begin(), supportedModes.end(), mode) != supportedModes.end();
     };
-    m_drawImage.imageMemory = vk::raii::DeviceMemory(m_device, allocInfo);
-    m_drawImage.image.bindMemory(m_drawImage.imageMemory, 0);
 
-    auto imageViewCreateInfo =
-        vkStructsUtils::makeImageViewCreateInfo(m_drawImage.format, m_drawImage.image, vk::ImageAspectFlagBits::eColor);
-    m_drawImage.imageView = vk::raii::ImageView(m_device, imageViewCreateInfo);
+    std::vector<vk::PresentModeKHR> candidates{m_requestedPresentMode};
+    switch(m_requestedPresentMode) {
+        case vk::PresentModeKHR::eMailbox:
+            candidates.push_back(vk::PresentModeKHR::eImmediate);
+            break;
+        case vk::PresentModeKHR::eImmediate:
+            candidates.push_back(vk::PresentModeKHR::eMailbox);
+            break;
+        default:
+            break;
+    }
+    for(auto mode : candidates) {
+        if(isSupported(mode)) {
+            return mode;
+        }
+    }
+    return vk::PresentModeKHR::eFifo;
+}
+
+void Engine::resize(uint32_t width, uint32_t height) {
+    m_guiSettings.windowExtent = vk::Extent2D{.width = width, .height = height};
+    if(isRenderThreadRunning()) {
+        // Handed over with the next GUI frame.
+        return;
+    }
+    m_windowExtent = m_guiSettings.windowExtent;
+    m_swapchainDirty = true;
+}
 
-    std::cout << "Success to create swapchain.\n";
+void Engine::setPresentMode(vk::PresentModeKHR presentMode) {
+    if(presentMode != m_requestedPresentMode) {
+        m_requestedPresentMode = presentMode;
+        m_swapchainDirty = true;
+    }
+}
+
+void Engine::createDrawImage(vk::Extent2D extent) {
+    auto imageCreateInfo = vkStructsUtils::makeImageCreateInfo(
+        vk::Format::eR16G16B16A16Sfloat,
+        vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eStorage |
+            vk::ImageUsageFlagBits::eColorAttachment,
+        {.width = extent.width, .height = extent.height, .depth = 1});
+    m_drawImage = m_allocator.createImage(imageCreateInfo, MemoryUsage::eGpuOnly, MemoryCategory::eRenderTarget);
+    if(m_bindless) {
+        // The old slot may still be read by frames in flight.
+        m_bindlessTable.retire(BindlessType::eStorageImage, m_drawImageIndex, m_frameNumber);
+        m_drawImageIndex = m_bindlessTable.addStorageImage(m_drawImage.imageView);
+    }
 }
 
-void Engine::initFrameDatas() {
+void Engine::initImmediateSubmit() {
     vk::CommandPoolCreateInfo poolInfo{
         .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
         .queueFamilyIndex = getGraphicsQueueFamilyIndex(),
     };
-    m_commandPool = vk::raii::CommandPool(m_device, poolInfo);
+    m_immCommandPool = vk::raii::CommandPool(m_device, poolInfo);
+    vk::CommandBufferAllocateInfo allocInfo{
+        .commandPool = m_immCommandPool,
+        .level = vk::CommandBufferLevel::ePrimary,
+        .commandBufferCount = 1,
+    };
+    m_immCommandBuffer = std::move(m_device.allocateCommandBuffers(allocInfo).front());
+    m_immFence = vk::raii::Fence(m_device, vk::FenceCreateInfo{});
+}
+
+void Engine::immediateSubmit(std::function<void(vk::CommandBuffer cmd)>&& function) {
+    vk::CommandBuffer cmd = m_immCommandBuffer;
+    cmd.reset();
+    cmd.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    function(cmd);
+    cmd.end();
+
+    auto cmdInfo = vkStructsUtils::makeCommandBufferSubmitInfo(cmd);
+    auto submitInfo = vkStructsUtils::makeSubmitInfo(&cmdInfo, nullptr, nullptr);
+    {
+        std::lock_guard queueLock(m_graphicsQueueMutex);
+        m_graphicsQueue.submit2(submitInfo, m_immFence);
+    }
+    VK_CHECK(m_device.waitForFences(*m_immFence, vk::True, UINT64_MAX));
+    m_device.resetFences(*m_immFence);
+}
+
+void Engine::initFrameDatas(uint32_t framesInFlight) {
+    if(!*m_commandPool) {
+        vk::CommandPoolCreateInfo poolInfo{
+            .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+            .queueFamilyIndex = getGraphicsQueueFamilyIndex(),
+        };
+        m_commandPool = vk::raii::CommandPool(m_device, poolInfo);
+
+        vk::SemaphoreTypeCreateInfo timelineInfo{
+            .semaphoreType = vk::SemaphoreType::eTimeline,
+            .initialValue = m_frameNumber,
+        };
+        m_frameTimeline = vk::raii::Semaphore(m_device, vk::SemaphoreCreateInfo{.pNext = &timelineInfo});
+
+        if(m_asyncCompute) {
+            m_computeCommandPool = vk::raii::CommandPool(
+                m_device, vk::CommandPoolCreateInfo{.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                                                    .queueFamilyIndex = getComputeQueueFamilyIndex()});
+            m_computeTimeline = vk::raii::Semaphore(m_device, vk::SemaphoreCreateInfo{.pNext = &timelineInfo});
+        }
+        m_gpuProfiler.init(m_chosenGPU, getGraphicsQueueFamilyIndex());
+    }
+    // Command buffers go back to the pool when the old frames are destroyed.
+    for(const auto& frame : m_frames) {
+        m_bindlessTable.retire(BindlessType::eStorageImage, frame.backgroundImageIndex, m_frameNumber);
+    }
+    m_frames.clear();
+
     vk::CommandBufferAllocateInfo allocInfo{
         .commandPool = m_commandPool,
         .level = vk::CommandBufferLevel::ePrimary,
-        .commandBufferCount = FRAME_OVERLAP,
+        .commandBufferCount = framesInFlight,
     };
     auto commandBuffers = m_device.allocateCommandBuffers(allocInfo);
 
-    vk::FenceCreateInfo fenceInfo{
-        .flags = vk::FenceCreateFlagBits::eSignaled,
-    };
     vk::SemaphoreCreateInfo semaphoreInfo{};
 
-    for(auto i = 0; i < FRAME_OVERLAP; i++) {
+    std::array<DescriptorAllocator::PoolSizeRatio, 1> descriptorRatios = {{
+        {vk::DescriptorType::eStorageImage, 1},
+    }};
+
+    vk::CommandPoolCreateInfo recordPoolInfo{
+        .flags = vk::CommandPoolCreateFlagBits::eTransient,
+        .queueFamilyIndex = getGraphicsQueueFamilyIndex(),
+    };
+
+    m_frames.resize(framesInFlight);
+    for(uint32_t i = 0; i < framesInFlight; i++) {
         m_frames[i].commandBuffer = std::move(commandBuffers[i]);
-        m_frames[i].renderFence = vk::raii::Fence(m_device, fenceInfo);
         m_frames[i].swapchainSemaphore = vk::raii::Semaphore(m_device, semaphoreInfo);
+        m_frames[i].queryPool = m_gpuProfiler.createQueryPool(m_device);
+        m_frames[i].timelineValue = m_frameNumber;
+        m_frames[i].descriptors.init(m_device, 4, descriptorRatios);
+        for(uint32_t job = 0; job < RECORD_JOB_COUNT; job++) {
+            auto& pool = m_frames[i].recordPools.emplace_back(m_device, recordPoolInfo);
+            vk::CommandBufferAllocateInfo secondaryInfo{
+                .commandPool = pool,
+                .level = vk::CommandBufferLevel::eSecondary,
+                .commandBufferCount = 1,
+            };
+            m_frames[i].recordCommandBuffers.push_back(std::move(m_device.allocateCommandBuffers(secondaryInfo)[0]));
+        }
+        if(m_asyncCompute) {
+            vk::CommandBufferAllocateInfo computeInfo{
+                .commandPool = m_computeCommandPool,
+                .level = vk::CommandBufferLevel::ePrimary,
+                .commandBufferCount = 1,
+            };
+            m_frames[i].computeCommandBuffer = std::move(m_device.allocateCommandBuffers(computeInfo)[0]);
+        }
+    }
+    createBackgroundImages();
+    // Queries must be reset once before the first frame reads their availability.
+    immediateSubmit([&](vk::CommandBuffer cmd) {
+        for(const auto& frame : m_frames) {
+            m_gpuProfiler.resetQueryPool(cmd, frame.queryPool);
+        }
+    });
+}
+
+FrameData& Engine::beginFrame() {
+    if(m_requestedFramesInFlight != m_frames.size()) {
+        // The per-frame semaphores and command buffers are rebuilt, so every submitted frame has to drain first.
+        {
+            std::lock_guard queueLock(m_graphicsQueueMutex);
+            m_device.waitIdle();
+        }
+        initFrameDatas(m_requestedFramesInFlight);
     }
+    auto& frame = getCurrentFame();
 
-    m_swapchainRenderSemaphores.clear();
-    for(auto i = 0; i < m_swapchainImages.size(); i++) {
-        m_swapchainRenderSemaphores.emplace_back(m_device, semaphoreInfo);
+    vk::SemaphoreWaitInfo waitInfo{
+        .semaphoreCount = 1,
+        .pSemaphores = &*m_frameTimeline,
+        .pValues = &frame.timelineValue,
+    };
+    {
+        VKR_TRACE_ZONE("wait frame timeline");
+        VK_CHECK(m_device.waitSemaphores(waitInfo, UINT64_MAX));
     }
+    // Frame N signals N + 1, so everything retired up to the counter value is no longer referenced.
+    m_deletionQueue.flush(m_frameTimeline.getCounterValue());
+    m_frameCapture.collect(m_frameTimeline.getCounterValue());
+    m_bindlessTable.collect(m_frameTimeline.getCounterValue());
+    checkMemoryBudget();
+
+    frame.descriptors.clearPools();
+    if(!m_bindless) {
+        frame.backgroundDescriptorSet = allocateStorageImageSet(frame, frame.backgroundImage.imageView);
+        frame.drawImageDescriptorSet = allocateStorageImageSet(frame, m_drawImage.imageView);
+    }
+    return frame;
 }
 
 void Engine::draw() {
-    const auto& currentFrameData = getCurrentFame();
+    VKR_TRACE_ZONE("Engine::draw");
+    if(m_frameInputs.update()) {
+        applySettings(m_frameInputs.front().settings);
+    }
+    auto& currentFrameData = beginFrame();
+
+    if(m_swapchainDirty && !recreateSwapchain()) {
+        return;
+    }
 
-    VK_CHECK(m_device.waitForFences(*currentFrameData.renderFence, vk::True, UINT64_MAX));
-    m_device.resetFences(*currentFrameData.renderFence);
+    uint32_t swapchainImageIndex;
+    try {
+        VKR_TRACE_ZONE("acquireNextImage");
+        auto [result, imageIndex] =
+            m_swapchain.acquireNextImage(UINT64_MAX, currentFrameData.swapchainSemaphore, nullptr);
+        if(result == vk::Result::eSuboptimalKHR) {
+            // Still presentable, rebuild at the next frame boundary.
+            m_swapchainDirty = true;
+        }
+        swapchainImageIndex = imageIndex;
+    } catch(const vk::OutOfDateKHRError&) {
+        m_swapchainDirty = true;
+        return;
+    }
+    collectRetiredSwapchains(swapchainImageIndex);
 
-    auto [result, swapchainImageIndex] =
-        m_swapchain.acquireNextImage(UINT16_MAX, currentFrameData.swapchainSemaphore, nullptr);
-    VK_CHECK(result);
+    m_gpuProfiler.collect(currentFrameData.queryPool);
+    updateRenderExtent();
+    vk::QueryPool queryPool = currentFrameData.queryPool;
+    reloadChangedShaders();
+    collectPipelines();
+    updateBackgroundKey(currentFrameData);
+    submitBackgroundCompute(currentFrameData);
 
     vk::Semaphore swapchainRenderSemaphore = m_swapchainRenderSemaphores[swapchainImageIndex];
 
     auto acquiredSwapchainImage = m_swapchainImages[swapchainImageIndex];
 
+    recordSecondaries(currentFrameData);
+
+    m_renderGraph.reset();
+    // The previous frame's blit read the draw image on this queue, its contents are not kept.
+    auto drawImage = m_renderGraph.importImage(m_drawImage.image, vk::ImageLayout::eUndefined,
+                                               vk::PipelineStageFlagBits2::eAllTransfer);
+    // Chained to the acquire semaphore wait.
+    auto swapchainImage = m_renderGraph.importImage(acquiredSwapchainImage, vk::ImageLayout::eUndefined,
+                                                    vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+    addScenePasses(m_renderGraph, currentFrameData, drawImage);
+    m_renderGraph
+        .addPass("blit",
+                 [this, queryPool, acquiredSwapchainImage](vk::CommandBuffer cmd) {
+                     m_gpuProfiler.beginPass(cmd, queryPool, GpuPass::eBlit);
+                     imageUtils::copyImageToImage(cmd, m_drawImage.image, acquiredSwapchainImage, m_renderExtent,
+                                                  m_swapchainExtent);
+                     m_gpuProfiler.endPass(cmd, queryPool, GpuPass::eBlit);
+                 })
+        .use(drawImage, ResourceUsage::eTransferSrc)
+        .use(swapchainImage, ResourceUsage::eTransferDst);
+    addCapturePass(m_renderGraph, drawImage, m_frameNumber + 1);
+#ifndef VK_USE_PLATFORM_METAL_EXT
+    m_renderGraph
+        .addPass("imgui",
+                 [this, queryPool, swapchainImageIndex](vk::CommandBuffer cmd) {
+                     m_gpuProfiler.beginPass(cmd, queryPool, GpuPass::eImGui);
+                     drawImGui(cmd, m_swapchainImageViews[swapchainImageIndex]);
+                     m_gpuProfiler.endPass(cmd, queryPool, GpuPass::eImGui);
+                 })
+        .use(swapchainImage, ResourceUsage::eColorAttachment);
+#endif
+    m_renderGraph.exportResource(swapchainImage, ResourceUsage::ePresent);
+
     vk::CommandBuffer cmd = currentFrameData.commandBuffer;
     cmd.reset();
     cmd.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-
-    imageUtils::transitionImage(cmd, m_drawImage.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-
-    drawBackground(cmd, m_drawImage.image);
-
-    imageUtils::transitionImage(cmd, m_drawImage.image, vk::ImageLayout::eGeneral,
-                                vk::ImageLayout::eColorAttachmentOptimal);
-
-    drawGeometry(cmd);
-
-    imageUtils::transitionImage(cmd, m_drawImage.image, vk::ImageLayout::eColorAttachmentOptimal,
-                                vk::ImageLayout::eTransferSrcOptimal);
-    imageUtils::transitionImage(cmd, acquiredSwapchainImage, vk::ImageLayout::eUndefined,
-                                vk::ImageLayout::eTransferDstOptimal);
-    imageUtils::copyImageToImage(cmd, m_drawImage.image, acquiredSwapchainImage,
-                                 {.width = m_drawImage.imageExtent.width, .height = m_drawImage.imageExtent.height},
-                                 m_swapchainExtent);
-#ifdef VK_USE_PLATFORM_METAL_EXT
-    imageUtils::transitionImage(cmd, acquiredSwapchainImage, vk::ImageLayout::eTransferDstOptimal,
-                                vk::ImageLayout::ePresentSrcKHR);
-#else
-    imageUtils::transitionImage(cmd, acquiredSwapchainImage, vk::ImageLayout::eTransferDstOptimal,
-                                vk::ImageLayout::eColorAttachmentOptimal);
-    drawImGui(cmd, m_swapchainImageViews[swapchainImageIndex]);
-    imageUtils::transitionImage(cmd, acquiredSwapchainImage, vk::ImageLayout::eColorAttachmentOptimal,
-                                vk::ImageLayout::ePresentSrcKHR);
-#endif
-
+    // Passes skipped this frame must not report the timings they wrote in an earlier one.
+    m_gpuProfiler.resetQueryPool(cmd, currentFrameData.queryPool);
+    m_renderGraph.execute(cmd);
     cmd.end();
 
     auto cmdInfo = vkStructsUtils::makeCommandBufferSubmitInfo(cmd);
-    auto waitInfo = vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-                                                            currentFrameData.swapchainSemaphore);
-    auto signalInfo =
-        vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eAllGraphics, swapchainRenderSemaphore);
-    auto submitInfo = vkStructsUtils::makeSubmitInfo(&cmdInfo, &signalInfo, &waitInfo);
-    m_graphicsQueue.submit2(submitInfo, currentFrameData.renderFence);
+    const uint64_t signalValue = m_frameNumber + 1;
+    std::vector    waitInfos = {
+        vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                                                currentFrameData.swapchainSemaphore),
+    };
+    addFrameWaits(waitInfos, signalValue);
+    std::array signalInfos = {
+        vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eAllGraphics, swapchainRenderSemaphore),
+        vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eAllCommands, m_frameTimeline,
+                                                signalValue),
+    };
+    auto submitInfo = vkStructsUtils::makeSubmitInfo(&cmdInfo, signalInfos, waitInfos);
+    {
+        VKR_TRACE_ZONE("submit2");
+        std::lock_guard queueLock(m_graphicsQueueMutex);
+        m_graphicsQueue.submit2(submitInfo);
+    }
+    currentFrameData.timelineValue = signalValue;
 
     vk::PresentInfoKHR presentInfo{
         .swapchainCount = 1,
@@ -257,98 +726,621 @@ void Engine::draw() {
         .pWaitSemaphores = &swapchainRenderSemaphore,
         .pImageIndices = &swapchainImageIndex,
     };
-    VK_CHECK(m_graphicsQueue.presentKHR(presentInfo));
+    vk::Fence                        presentFence;
+    vk::SwapchainPresentFenceInfoEXT presentFenceInfo{.swapchainCount = 1, .pFences = &presentFence};
+    if(m_swapchainMaintenance1) {
+        if(m_freePresentFences.empty()) {
+            m_presentFences.emplace_back(m_device, vk::FenceCreateInfo{});
+        } else {
+            m_device.resetFences(*m_freePresentFences.back());
+            m_presentFences.push_back(std::move(m_freePresentFences.back()));
+            m_freePresentFences.pop_back();
+        }
+        presentFence = m_presentFences.back();
+        presentInfo.pNext = &presentFenceInfo;
+    }
+    try {
+        VKR_TRACE_ZONE("presentKHR");
+        std::lock_guard queueLock(m_graphicsQueueMutex);
+        if(m_graphicsQueue.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR) {
+            m_swapchainDirty = true;
+        }
+    } catch(const vk::OutOfDateKHRError&) {
+        m_swapchainDirty = true;
+    }
+    m_presentCount++;
+    publishFrameStats();
     m_frameNumber++;
 }
 
-void Engine::drawBackground(vk::CommandBuffer cmd, vk::Image image) {
+void Engine::startRenderThread() {
+    if(isRenderThreadRunning()) {
+        return;
+    }
+    m_renderThreadRunning = true;
+    m_renderThread = std::thread([this] {
+        VKR_TRACE_THREAD_NAME("render");
+        while(m_renderThreadRunning) {
+            draw();
+            if(m_minimized) {
+                // Nothing can be presented, wait for a resize instead of spinning through empty frames.
+                std::this_thread::sleep_for(MINIMIZED_POLL_INTERVAL);
+            }
+        }
+    });
+}
+
+void Engine::stopRenderThread() {
+    m_renderThreadRunning = false;
+    if(m_renderThread.joinable()) {
+        m_renderThread.join();
+    }
+}
+
+void Engine::drawOffscreen() {
+    VKR_TRACE_ZONE("Engine::drawOffscreen");
+    auto& currentFrameData = beginFrame();
+    m_gpuProfiler.collect(currentFrameData.queryPool);
+    // readbackDrawImage() returns the whole image.
+    m_renderExtent = getDrawExtent();
+    reloadChangedShaders();
+    collectPipelines();
+    updateBackgroundKey(currentFrameData);
+    submitBackgroundCompute(currentFrameData);
+
+    recordSecondaries(currentFrameData);
+
+    m_renderGraph.reset();
+    auto drawImage = m_renderGraph.importImage(m_drawImage.image, vk::ImageLayout::eUndefined,
+                                               vk::PipelineStageFlagBits2::eAllTransfer);
+    addScenePasses(m_renderGraph, currentFrameData, drawImage);
+    addCapturePass(m_renderGraph, drawImage, m_frameNumber + 1);
+    // Leave the frame readable, readbackDrawImage() copies from this layout.
+    m_renderGraph.exportResource(drawImage, ResourceUsage::eTransferSrc);
+
+    vk::CommandBuffer cmd = currentFrameData.commandBuffer;
+    cmd.reset();
+    cmd.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    m_gpuProfiler.resetQueryPool(cmd, currentFrameData.queryPool);
+    m_renderGraph.execute(cmd);
+    cmd.end();
+
+    auto cmdInfo = vkStructsUtils::makeCommandBufferSubmitInfo(cmd);
+    const uint64_t signalValue = m_frameNumber + 1;
+    auto           signalInfo = vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eAllCommands,
+                                                                        m_frameTimeline, signalValue);
+    std::vector<vk::SemaphoreSubmitInfo> waitInfos;
+    addFrameWaits(waitInfos, signalValue);
+    auto submitInfo = vkStructsUtils::makeSubmitInfo(&cmdInfo, {&signalInfo, 1}, waitInfos);
+    {
+        VKR_TRACE_ZONE("submit2");
+        std::lock_guard queueLock(m_graphicsQueueMutex);
+        m_graphicsQueue.submit2(submitInfo);
+    }
+    currentFrameData.timelineValue = signalValue;
+    m_frameNumber++;
+}
+
+std::vector<uint8_t> Engine::readbackDrawImage() {
+    const vk::DeviceSize pixelSize = 4 * sizeof(uint16_t);
+    const vk::DeviceSize size = m_drawImage.imageExtent.width * m_drawImage.imageExtent.height * pixelSize;
+
+    AllocatedBuffer readback = m_allocator.createBuffer(size, vk::BufferUsageFlagBits::eTransferDst,
+                                                        MemoryUsage::eGpuToCpu, MemoryCategory::eReadback);
+
+    // Submissions on the graphics queue execute in order, so the copy lands after the last offscreen frame.
+    immediateSubmit([&](vk::CommandBuffer cmd) {
+        vk::BufferImageCopy region{
+            .bufferOffset = 0,
+            .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .layerCount = 1},
+            .imageExtent = m_drawImage.imageExtent,
+        };
+        cmd.copyImageToBuffer(m_drawImage.image, vk::ImageLayout::eTransferSrcOptimal, readback.buffer, region);
+    });
+
+    std::vector<uint8_t> pixels(size);
+    std::memcpy(pixels.data(), readback.allocation.getMappedData(), size);
+    return pixels;
+}
+
+void Engine::drawBackground(vk::CommandBuffer cmd, const AllocatedImage& target, vk::DescriptorSet set,
+                            uint32_t bindlessIndex) {
     ComputeEffect& effect = m_backgroundEffects[m_currentBackgroundEffect];
 
-    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, effect.pipeline);
-    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_gradientPipelineLayout, 0, *m_drawImageDescriptorSet,
-                           nullptr);
+    // Fallback while the effect is still compiling.
+    if(!*effect.pipeline) {
+        vk::ClearColorValue clearColor{};
+        clearColor.float32[3] = 1.f;
+        auto range = vkStructsUtils::makeImageSubresourceRange(vk::ImageAspectFlagBits::eColor);
+        cmd.clearColorImage(target.image, vk::ImageLayout::eGeneral, clearColor, range);
+        return;
+    }
+
+    dispatchEffect(cmd, effect, effect.pipeline, effect.workgroupSize, m_renderExtent, set, bindlessIndex);
+}
+
+void Engine::dispatchEffect(vk::CommandBuffer cmd, const ComputeEffect& effect, vk::Pipeline pipeline,
+                            vk::Extent2D workgroupSize, vk::Extent2D extent, vk::DescriptorSet set,
+                            uint32_t bindlessIndex) {
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    if(m_bindless) {
+        // The table is bound once per command buffer, the target is picked by index.
+        cmd.pushConstants(m_gradientPipelineLayout, vk::ShaderStageFlagBits::eCompute,
+                          sizeof(ComputePushConstants) + 2 * sizeof(uint32_t), sizeof(uint32_t), &bindlessIndex);
+    } else {
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_gradientPipelineLayout, 0, set, nullptr);
+    }
     cmd.pushConstants(m_gradientPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(ComputePushConstants),
                       &effect.data);
+    std::array<uint32_t, 2> renderExtent = {extent.width, extent.height};
+    cmd.pushConstants(m_gradientPipelineLayout, vk::ShaderStageFlagBits::eCompute, sizeof(ComputePushConstants),
+                      sizeof(renderExtent), renderExtent.data());
 
-    cmd.dispatch(std::ceil(m_drawImage.imageExtent.width / 16.f), std::ceil(m_drawImage.imageExtent.height / 16.f), 1);
+    cmd.dispatch((extent.width + workgroupSize.width - 1) / workgroupSize.width,
+                 (extent.height + workgroupSize.height - 1) / workgroupSize.height, 1);
 }
 
-void Engine::initDescriptors() {
-    std::vector<DescriptorAllocator::PoolSizeRatio> sizes{
-        {vk::DescriptorType::eStorageImage, 1},
-    };
-    m_globalDescriptorAllocator.initPool(m_device, 10, sizes);
+void Engine::submitBackgroundCompute(FrameData& frame) {
+    VKR_TRACE_ZONE("submitBackgroundCompute");
+    if(!m_asyncCompute) {
+        return;
+    }
+    auto signalInfo = vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eAllCommands,
+                                                              m_computeTimeline, m_frameNumber + 1);
+    if(!frame.backgroundDirty) {
+        // Nothing to shade, still advance the timeline the graphics submit waits on.
+        m_computeQueue.submit2(vk::SubmitInfo2{.signalSemaphoreInfoCount = 1, .pSignalSemaphoreInfos = &signalInfo});
+        return;
+    }
 
-    {
-        DescriptorLayoutBuilder builder;
-        builder.addBinding(0, vk::DescriptorType::eStorageImage);
-        m_drawImageDescriptorSetLayout = builder.build(m_device, vk::ShaderStageFlagBits::eCompute);
+    // The graphics frame that last read this background image already passed the frame timeline wait.
+    vk::CommandBuffer cmd = frame.computeCommandBuffer;
+    cmd.reset();
+    cmd.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    if(m_bindless) {
+        m_bindlessTable.bind(cmd, vk::PipelineBindPoint::eCompute, m_gradientPipelineLayout);
+    }
+
+    m_computeGraph.reset();
+    auto target = m_computeGraph.importImage(frame.backgroundImage.image, vk::ImageLayout::eUndefined);
+    m_computeGraph
+        .addPass("background",
+                 [this, &frame](vk::CommandBuffer cmd) {
+                     drawBackground(cmd, frame.backgroundImage, frame.backgroundDescriptorSet,
+                                    frame.backgroundImageIndex);
+                 })
+        .use(target, getBackgroundUsage());
+    // Copied on the graphics queue once it waited on the compute timeline.
+    m_computeGraph.exportResource(target, ResourceUsage::eTransferSrc);
+    m_computeGraph.execute(cmd);
+    cmd.end();
+
+    auto cmdInfo = vkStructsUtils::makeCommandBufferSubmitInfo(cmd);
+    auto submitInfo = vkStructsUtils::makeSubmitInfo(&cmdInfo, &signalInfo, nullptr);
+    m_computeQueue.submit2(submitInfo);
+}
+
+void Engine::createBackgroundImages() {
+    // Transfer dst for the clear while the effect compiles.
+    auto imageCreateInfo = vkStructsUtils::makeImageCreateInfo(m_drawImage.format,
+                                                               vk::ImageUsageFlagBits::eStorage |
+                                                                   vk::ImageUsageFlagBits::eTransferSrc |
+                                                                   vk::ImageUsageFlagBits::eTransferDst,
+                                                               m_drawImage.imageExtent);
+    // Concurrent sharing lets the graphics queue read what the compute queue wrote without ownership transfers.
+    std::array queueFamilies = {getGraphicsQueueFamilyIndex(), getComputeQueueFamilyIndex()};
+    if(m_asyncCompute) {
+        imageCreateInfo.sharingMode = vk::SharingMode::eConcurrent;
+        imageCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        imageCreateInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
+
+    for(auto& frame : m_frames) {
+        if(*frame.backgroundImage.image) {
+            m_deletionQueue.push(m_frameNumber, std::move(frame.backgroundImage));
+        }
+        frame.backgroundImage =
+            m_allocator.createImage(imageCreateInfo, MemoryUsage::eGpuOnly, MemoryCategory::eRenderTarget);
+        frame.backgroundKey = 0;
+        if(m_bindless) {
+            m_bindlessTable.retire(BindlessType::eStorageImage, frame.backgroundImageIndex, m_frameNumber);
+            frame.backgroundImageIndex = m_bindlessTable.addStorageImage(frame.backgroundImage.imageView);
+        }
     }
+}
+
+void Engine::updateRenderExtent() {
+    if(!m_dynamicResolution || !m_gpuProfiler.isSupported()) {
+        m_renderScale = 1.f;
+    } else if(float frameMs = m_gpuProfiler.getFrameMs(); frameMs > 0.f) {
+        // GPU time grows roughly with the pixel count, so the scale hitting the budget is the square root of the
+        // ratio. The measurement lags by the frames in flight, only move part of the way and ignore small errors so
+        // the resolution does not oscillate.
+        constexpr float response = 0.25f;
+        constexpr float deadband = 0.02f;
+        float           ideal = m_renderScale * std::sqrt(m_targetFrameMs / frameMs);
+        if(std::abs(ideal - m_renderScale) > deadband) {
+            m_renderScale += (ideal - m_renderScale) * response;
+        }
+    }
+    m_renderScale = std::clamp(m_renderScale, m_minRenderScale, 1.f);
+
+    vk::Extent2D maxExtent = getDrawExtent();
+    m_renderExtent = vk::Extent2D{
+        .width = std::max(1u, static_cast<uint32_t>(maxExtent.width * m_renderScale)),
+        .height = std::max(1u, static_cast<uint32_t>(maxExtent.height * m_renderScale)),
+    };
+}
+
+void Engine::initDescriptors() {
+    DescriptorLayoutBuilder builder;
+    builder.addBinding(0, vk::DescriptorType::eStorageImage);
+    m_drawImageDescriptorSetLayout = builder.build(m_device, vk::ShaderStageFlagBits::eCompute);
+}
 
-    m_drawImageDescriptorSet = m_globalDescriptorAllocator.allocate(m_device, m_drawImageDescriptorSetLayout);
+vk::DescriptorSet Engine::allocateStorageImageSet(FrameData& frame, vk::ImageView imageView) {
+    auto                    set = frame.descriptors.allocate(m_device, m_drawImageDescriptorSetLayout);
     vk::DescriptorImageInfo imageInfo{
         .imageLayout = vk::ImageLayout::eGeneral,
-        .imageView = m_drawImage.imageView,
+        .imageView = imageView,
     };
-    vk::WriteDescriptorSet drawImageWrite{
+    vk::WriteDescriptorSet imageWrite{
         .dstBinding = 0,
-        .dstSet = m_drawImageDescriptorSet,
+        .dstSet = set,
         .descriptorCount = 1,
         .descriptorType = vk::DescriptorType::eStorageImage,
         .pImageInfo = &imageInfo,
     };
-    m_device.updateDescriptorSets(drawImageWrite, {});
+    m_device.updateDescriptorSets(imageWrite, {});
+    return set;
 }
 
 void Engine::initComputePipeline() {
+    // The effect parameters are followed by the render extent and, for bindless variants, the target image index.
     vk::PushConstantRange pushConstant{
-        .offset = 0,
-        .size = sizeof(ComputePushConstants),
         .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = static_cast<uint32_t>(sizeof(ComputePushConstants) + (m_bindless ? 3 : 2) * sizeof(uint32_t)),
     };
 
+    vk::DescriptorSetLayout      setLayout = m_bindless ? m_bindlessTable.getLayout() : *m_drawImageDescriptorSetLayout;
     vk::PipelineLayoutCreateInfo computeLayoutInfo{
         .setLayoutCount = 1,
-        .pSetLayouts = &*m_drawImageDescriptorSetLayout,
+        .pSetLayouts = &setLayout,
         .pushConstantRangeCount = 1,
         .pPushConstantRanges = &pushConstant,
     };
     m_gradientPipelineLayout = vk::raii::PipelineLayout(m_device, computeLayoutInfo);
 
-    auto gradientShaderModule = utils::loadShaderModule(SHADER_DIR "/gradient_color.comp.spv", m_device);
-    vk::PipelineShaderStageCreateInfo stageInfo{
-        .stage = vk::ShaderStageFlagBits::eCompute,
-        .module = gradientShaderModule,
-        .pName = "main",
-    };
-    auto skyShaderModule = utils::loadShaderModule(SHADER_DIR "/sky.comp.spv", m_device);
-
-    vk::ComputePipelineCreateInfo computePipelineCreateInfo{
-        .layout = m_gradientPipelineLayout,
-        .stage = stageInfo,
-    };
-
     ComputeEffect gradient{
-        .layout = m_gradientPipelineLayout,
         .name = "gradient",
+        .shader = "gradient_color.comp.spv",
+        .layout = m_gradientPipelineLayout,
         .data =
             {
                 .data1 = glm::vec4(1, 0, 0, 1),
                 .data2 = glm::vec4(0, 1, 1, 1),
             },
     };
-    gradient.pipeline = m_device.createComputePipeline(nullptr, computePipelineCreateInfo);
-
-    computePipelineCreateInfo.stage.module = skyShaderModule;
     ComputeEffect sky{
-        .layout = m_gradientPipelineLayout,
         .name = "sky",
+        .shader = "sky.comp.spv",
+        .layout = m_gradientPipelineLayout,
         .data = {.data1 = glm::vec4(0.1, 0.2, 0.4, 0.97)},
     };
-    sky.pipeline = m_device.createComputePipeline(nullptr, computePipelineCreateInfo);
 
     m_backgroundEffects.push_back(std::move(gradient));
     m_backgroundEffects.push_back(std::move(sky));
+
+    tuneWorkgroupSizes();
+
+    // Effects are fixed from here on, so the pending jobs can point into the vector.
+    for(auto& effect : m_backgroundEffects) {
+        registerPipeline(effect.name, &effect.pipeline, {effect.shader},
+                         [this, &effect] { return buildComputePipeline(effect.shader, effect.workgroupSize); });
+    }
+}
+
+void Engine::tuneWorkgroupSizes() {
+    std::vector<ComputeEffect*> untuned;
+    for(auto& effect : m_backgroundEffects) {
+        if(auto cached = m_workgroupSizeCache.find(effect.name)) {
+            effect.workgroupSize = *cached;
+        } else {
+            untuned.push_back(&effect);
+        }
+    }
+    if(untuned.empty() || !m_workgroupTuning || !m_gpuProfiler.isSupported()) {
+        return;
+    }
+
+    constexpr std::array<vk::Extent2D, 9> candidateSizes = {{
+        {8, 8},
+        {16, 8},
+        {8, 16},
+        {16, 16},
+        {32, 8},
+        {32, 16},
+        {32, 32},
+        {64, 1},
+        {128, 1},
+    }};
+    constexpr uint32_t dispatchCount = 8;
+
+    auto                      limits = m_chosenGPU.getProperties().limits;
+    std::vector<vk::Extent2D> candidates;
+    for(auto size : candidateSizes) {
+        if(size.width <= limits.maxComputeWorkGroupSize[0] && size.height <= limits.maxComputeWorkGroupSize[1] &&
+           size.width * size.height <= limits.maxComputeWorkGroupInvocations) {
+            candidates.push_back(size);
+        }
+    }
+
+    // Compile every variant up front on the pipeline workers, timing only starts once they exist.
+    std::vector<std::vector<std::future<vk::raii::Pipeline>>> variants(untuned.size());
+    for(size_t i = 0; i < untuned.size(); i++) {
+        for(auto size : candidates) {
+            variants[i].push_back(m_threadPool.submit(
+                [this, shader = untuned[i]->shader, size] { return buildComputePipeline(shader, size); }));
+        }
+    }
+
+    // Shade the first frame's background image, nothing reads it before that frame shades it again.
+    FrameData&        frame = m_frames.front();
+    vk::Extent2D      extent = {frame.backgroundImage.imageExtent.width, frame.backgroundImage.imageExtent.height};
+    vk::DescriptorSet set = m_bindless ? nullptr : allocateStorageImageSet(frame, frame.backgroundImage.imageView);
+
+    vk::QueryPoolCreateInfo queryPoolInfo{
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = 2,
+    };
+    vk::raii::QueryPool queryPool(m_device, queryPoolInfo);
+    float               timestampPeriod = limits.timestampPeriod;
+    immediateSubmit([&](vk::CommandBuffer cmd) {
+        imageUtils::transitionImage(cmd, frame.backgroundImage.image, vk::ImageLayout::eUndefined,
+                                    vk::ImageLayout::eGeneral);
+    });
+
+    for(size_t i = 0; i < untuned.size(); i++) {
+        const ComputeEffect& effect = *untuned[i];
+        float                bestMs = std::numeric_limits<float>::max();
+        for(size_t c = 0; c < candidates.size(); c++) {
+            vk::raii::Pipeline pipeline = variants[i][c].get();
+            immediateSubmit([&](vk::CommandBuffer cmd) {
+                cmd.resetQueryPool(queryPool, 0, 2);
+                if(m_bindless) {
+                    m_bindlessTable.bind(cmd, vk::PipelineBindPoint::eCompute, m_gradientPipelineLayout);
+                }
+                // One untimed dispatch warms caches and clocks.
+                vk::MemoryBarrier2 barrier{
+                    .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+                    .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+                    .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+                    .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+                };
+                for(uint32_t d = 0; d <= dispatchCount; d++) {
+                    if(d == 1) {
+                        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, queryPool, 0);
+                    }
+                    dispatchEffect(cmd, effect, pipeline, candidates[c], extent, set, frame.backgroundImageIndex);
+                    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+                }
+                cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, queryPool, 1);
+            });
+            auto [result, ticks] = queryPool.getResults<uint64_t>(0, 2, 2 * sizeof(uint64_t), sizeof(uint64_t),
+                                                                  vk::QueryResultFlagBits::e64 |
+                                                                      vk::QueryResultFlagBits::eWait);
+            if(result != vk::Result::eSuccess || ticks[1] <= ticks[0]) {
+                continue;
+            }
+            float ms = static_cast<float>((ticks[1] - ticks[0]) * timestampPeriod * 1e-6) / dispatchCount;
+            if(ms < bestMs) {
+                bestMs = ms;
+                untuned[i]->workgroupSize = candidates[c];
+            }
+        }
+        if(bestMs == std::numeric_limits<float>::max()) {
+            continue;
+        }
+        m_workgroupSizeCache.store(effect.name, effect.workgroupSize);
+        std::cout << "Tuned " << effect.name << " to " << effect.workgroupSize.width << "x"
+                  << effect.workgroupSize.height << " workgroups, " << bestMs << " ms per dispatch.\n";
+    }
+    m_workgroupSizeCache.save();
+}
+
+vk::raii::Pipeline Engine::buildComputePipeline(const char* shader, vk::Extent2D workgroupSize) {
+    std::string name = shader;
+    if(m_bindless) {
+        // sky.comp.spv -> sky.comp.bindless.spv
+        name.insert(name.size() - std::strlen(".spv"), ".bindless");
+    }
+    auto shaderModule = m_shaderLibrary.get(name);
+
+    std::array specializationEntries = {
+        vk::SpecializationMapEntry{.constantID = 0, .offset = 0, .size = sizeof(uint32_t)},
+        vk::SpecializationMapEntry{.constantID = 1, .offset = sizeof(uint32_t), .size = sizeof(uint32_t)},
+    };
+    std::array<uint32_t, 2> specializationData = {workgroupSize.width, workgroupSize.height};
+    vk::SpecializationInfo  specializationInfo{
+        .mapEntryCount = static_cast<uint32_t>(specializationEntries.size()),
+        .pMapEntries = specializationEntries.data(),
+        .dataSize = sizeof(specializationData),
+        .pData = specializationData.data(),
+    };
+    vk::ComputePipelineCreateInfo computePipelineCreateInfo{
+        .stage = vkStructsUtils::makePipelineShaderStageCreateInfo(vk::ShaderStageFlagBits::eCompute, shaderModule),
+        .layout = m_gradientPipelineLayout,
+    };
+    computePipelineCreateInfo.stage.pSpecializationInfo = &specializationInfo;
+    return m_device.createComputePipeline(m_pipelineCache.get(), computePipelineCreateInfo);
+}
+
+void Engine::queuePipelineJob(const std::string& name, vk::raii::Pipeline* target,
+                              std::function<vk::raii::Pipeline()>&& build) {
+    auto future = m_threadPool.submit([build = std::move(build)] {
+        VKR_TRACE_ZONE("compile pipeline");
+        auto              start = std::chrono::steady_clock::now();
+        PipelineJobResult result{.pipeline = build()};
+        result.compileMs =
+            std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    });
+    m_pendingPipelines.push_back({.name = name, .target = target, .future = std::move(future)});
+}
+
+void Engine::registerPipeline(const std::string& name, vk::raii::Pipeline* target, std::vector<std::string> shaders,
+                              std::function<vk::raii::Pipeline()> build) {
+    queuePipelineJob(name, target, std::function(build));
+    m_reloadablePipelines.push_back(
+        {.name = name, .target = target, .shaders = std::move(shaders), .build = std::move(build)});
+}
+
+void Engine::reloadChangedShaders() {
+    auto changed = m_shaderWatcher.takeCompiled();
+    if(changed.empty()) {
+        return;
+    }
+    for(const auto& shader : changed) {
+        m_shaderLibrary.reload(shader);
+    }
+    // Bindless variants are recompiled together with their source, matching the base name is enough.
+    for(auto& pipeline : m_reloadablePipelines) {
+        if(std::ranges::any_of(pipeline.shaders, [&](const std::string& shader) {
+               return std::ranges::find(changed, shader) != changed.end();
+           })) {
+            queuePipelineJob(pipeline.name, pipeline.target, std::function(pipeline.build));
+        }
+    }
+}
+
+void Engine::collectPipelines() {
+    VKR_TRACE_ZONE("collectPipelines");
+    std::erase_if(m_pendingPipelines, [this](PendingPipeline& pending) {
+        if(pending.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        PipelineJobResult result;
+        try {
+            result = pending.future.get();
+        } catch(const std::exception& e) {
+            // A broken shader keeps whatever pipeline was there, the fallback if there was none.
+            std::cerr << "Pipeline " << pending.name << " failed to build: " << e.what() << "\n";
+            return true;
+        }
+        if(**pending.target) {
+            // Replaced by a hot reload, frames in flight may still be using the old one.
+            m_deletionQueue.push(m_frameNumber, std::move(*pending.target));
+        }
+        *pending.target = std::move(result.pipeline);
+        m_pipelineCompileTimes.emplace_back(pending.name, result.compileMs);
+        std::cout << "Pipeline " << pending.name << " compiled in " << result.compileMs << " ms.\n";
+        return true;
+    });
+}
+
+void Engine::waitForPipelines() {
+    for(auto& pending : m_pendingPipelines) {
+        pending.future.wait();
+    }
+    collectPipelines();
+}
+
+void Engine::initGuiSettings() {
+    m_guiSettings.windowExtent = m_windowExtent;
+    m_guiSettings.presentMode = m_requestedPresentMode;
+    m_guiSettings.framesInFlight = m_requestedFramesInFlight;
+    m_guiSettings.backgroundEffect = m_currentBackgroundEffect;
+    m_guiSettings.effectData.clear();
+    for(const auto& effect : m_backgroundEffects) {
+        m_guiSettings.effectData.push_back(effect.data);
+    }
+    m_guiSettings.parallelRecording = m_parallelRecording;
+    m_guiSettings.incrementalBackground = m_incrementalBackground;
+    m_guiSettings.dynamicResolution = m_dynamicResolution;
+    m_guiSettings.targetFrameMs = m_targetFrameMs;
+    m_guiSettings.minRenderScale = m_minRenderScale;
+    m_guiSettings.recording = m_frameCapture.isRecording();
+    m_appliedSettings = m_guiSettings;
+}
+
+void Engine::applySettings(const FrameSettings& settings) {
+    if(settings.windowExtent != m_windowExtent) {
+        m_windowExtent = settings.windowExtent;
+        m_swapchainDirty = true;
+    }
+    // Only what the GUI edited since the last frame is applied, so calls to the public setters in between stick.
+    const FrameSettings& applied = m_appliedSettings;
+    if(settings.presentMode != applied.presentMode) {
+        setPresentMode(settings.presentMode);
+    }
+    if(settings.framesInFlight != applied.framesInFlight) {
+        setFramesInFlight(settings.framesInFlight);
+    }
+    if(settings.backgroundEffect != applied.backgroundEffect) {
+        setBackgroundEffect(settings.backgroundEffect);
+    }
+    for(size_t i = 0; i < settings.effectData.size() && i < m_backgroundEffects.size(); i++) {
+        if(i >= applied.effectData.size() || settings.effectData[i] != applied.effectData[i]) {
+            m_backgroundEffects[i].data = settings.effectData[i];
+        }
+    }
+    if(settings.parallelRecording != applied.parallelRecording) {
+        setParallelRecording(settings.parallelRecording);
+    }
+    if(settings.incrementalBackground != applied.incrementalBackground) {
+        setIncrementalBackground(settings.incrementalBackground);
+    }
+    if(settings.dynamicResolution != applied.dynamicResolution) {
+        setDynamicResolution(settings.dynamicResolution);
+    }
+    if(settings.targetFrameMs != applied.targetFrameMs || settings.minRenderScale != applied.minRenderScale) {
+        setTargetFrameTime(settings.targetFrameMs, settings.minRenderScale);
+    }
+    if(settings.recording != applied.recording) {
+        if(settings.recording) {
+            m_frameCapture.record(CAPTURE_DIRECTORY, settings.captureFormat);
+        } else {
+            m_frameCapture.stop();
+        }
+    }
+    if(settings.screenshotCount != applied.screenshotCount) {
+        m_frameCapture.screenshot(CAPTURE_DIRECTORY, settings.captureFormat);
+    }
+    m_appliedSettings = settings;
+}
+
+void Engine::publishFrameStats() {
+    FrameStats& stats = m_frameStats.back();
+    stats.presentMode = m_presentMode;
+    stats.renderExtent = m_renderExtent;
+    stats.renderScale = m_renderScale;
+    stats.backgroundReused = m_backgroundReused;
+    stats.passCount = m_renderGraph.getPassCount();
+    stats.culledPassCount = m_renderGraph.getCulledPassCount();
+    stats.barrierBatchCount = m_renderGraph.getBarrierBatchCount();
+    for(uint32_t i = 0; i < GPU_PASS_COUNT; i++) {
+        stats.gpuPasses[i] = m_gpuProfiler.getStats(static_cast<GpuPass>(i));
+    }
+    stats.gpuFrameMs = m_gpuProfiler.getFrameMs();
+    stats.capturedFrames = m_frameCapture.getWrittenCount();
+    stats.droppedCaptures = m_frameCapture.getDroppedCount();
+    stats.memoryHeaps = m_memoryHeapStats;
+    stats.memoryCategories = m_allocator.getCategoryStats();
+    m_frameStats.publish();
+}
+
+void Engine::checkMemoryBudget() {
+    m_memoryHeapStats = m_allocator.getHeapStats();
+    m_overBudgetHeaps.resize(m_memoryHeapStats.size());
+    for(uint32_t i = 0; i < m_memoryHeapStats.size(); i++) {
+        const auto& heap = m_memoryHeapStats[i];
+        bool        over = heap.usage > static_cast<vk::DeviceSize>(heap.budget * m_memoryBudgetThreshold);
+        if(over && !m_overBudgetHeaps[i] && m_memoryBudgetCallback) {
+            m_memoryBudgetCallback(i, heap);
+        }
+        m_overBudgetHeaps[i] = over;
+    }
 }
 
 #ifndef VK_USE_PLATFORM_METAL_EXT
@@ -383,14 +1375,18 @@ void Engine::initImGUI(SDL_Window* pWindow) {
         .pColorAttachmentFormats = &format,
     };
 
+    // The backend cycles its vertex and index buffers through ImageCount slots, one per frame that can be in flight,
+    // so a buffer is never rewritten while the GPU still reads it.
+    uint32_t minImageCount = std::max(2u, m_chosenGPU.getSurfaceCapabilitiesKHR(*m_surface).minImageCount);
+
     ImGui_ImplVulkan_InitInfo initInfo{
         .Instance = *m_instance,
         .PhysicalDevice = *m_chosenGPU,
         .Device = *m_device,
         .Queue = *m_graphicsQueue,
         .DescriptorPool = *m_imguiPool,
-        .MinImageCount = 3,
-        .ImageCount = 3,
+        .MinImageCount = minImageCount,
+        .ImageCount = std::max(MAX_FRAMES_IN_FLIGHT, minImageCount),
         .UseDynamicRendering = true,
         .PipelineInfoMain =
             {
@@ -406,39 +1402,262 @@ void Engine::drawImGui(vk::CommandBuffer cmd, vk::ImageView targetImageView) {
         vkStructsUtils::makeColorAttachmentInfo(targetImageView, nullptr, vk::ImageLayout::eColorAttachmentOptimal);
     auto renderingInfo = vkStructsUtils::makeRenderingInfo(m_swapchainExtent, &colorAttachmentInfo, nullptr);
     cmd.beginRendering(renderingInfo);
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+    ImDrawData& drawData = m_frameInputs.front().gui.drawData;
+    if(drawData.Valid) {
+        // Texture uploads read ImGui's texture list, which the main thread updates while building the next frame,
+        // and submit to the graphics queue.
+        std::lock_guard textureLock(m_guiTextureMutex);
+        std::lock_guard queueLock(m_graphicsQueueMutex);
+        ImGui_ImplVulkan_RenderDrawData(&drawData, cmd);
+    }
     cmd.endRendering();
 }
 
 void Engine::setupGui() {
+    VKR_TRACE_ZONE("Engine::setupGui");
+    // The GUI edits m_guiSettings and shows the stats of the last drawn frame, it never touches the render state.
+    FrameSettings& settings = m_guiSettings;
+    m_frameStats.update();
+    const FrameStats& stats = m_frameStats.front();
+
+    std::unique_lock textureLock(m_guiTextureMutex);
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplSDL3_NewFrame();
     ImGui::NewFrame();
 
     if(ImGui::Begin("background")) {
-        ComputeEffect& selected = m_backgroundEffects[m_currentBackgroundEffect];
+        const ComputeEffect&  selected = m_backgroundEffects[settings.backgroundEffect];
+        ComputePushConstants& data = settings.effectData[settings.backgroundEffect];
+
+        ImGui::Text("Selected effect: %s, %ux%u workgroups", selected.name, selected.workgroupSize.width,
+                    selected.workgroupSize.height);
+
+        ImGui::SliderInt("Effect Index", &settings.backgroundEffect, 0, m_backgroundEffects.size() - 1);
+        ImGui::InputFloat4("data1", (float*)&data.data1);
+        ImGui::InputFloat4("data2", (float*)&data.data2);
+        ImGui::InputFloat4("data3", (float*)&data.data3);
+        ImGui::InputFloat4("data4", (float*)&data.data4);
+
+        constexpr std::array presentModes = {vk::PresentModeKHR::eFifo, vk::PresentModeKHR::eFifoRelaxed,
+                                             vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate};
+        constexpr std::array presentModeNames = {"FIFO", "FIFO relaxed", "mailbox", "immediate"};
+        int                  presentModeIndex = static_cast<int>(
+            std::find(presentModes.begin(), presentModes.end(), settings.presentMode) - presentModes.begin());
+        if(ImGui::Combo("present mode", &presentModeIndex, presentModeNames.data(),
+                        static_cast<int>(presentModeNames.size()))) {
+            settings.presentMode = presentModes[presentModeIndex];
+        }
+        ImGui::Text("Active present mode: %s", vk::to_string(stats.presentMode).c_str());
+
+        int framesInFlight = static_cast<int>(settings.framesInFlight);
+        if(ImGui::SliderInt("frames in flight", &framesInFlight, 1, MAX_FRAMES_IN_FLIGHT)) {
+            settings.framesInFlight = static_cast<uint32_t>(framesInFlight);
+        }
+        ImGui::Checkbox("parallel recording", &settings.parallelRecording);
+        ImGui::Text("Render thread: %s", isRenderThreadRunning() ? "on" : "off");
+        ImGui::Text("Async compute: %s", m_asyncCompute ? "on" : "off");
+        ImGui::Text("Bindless: %s", m_bindless ? "on" : "off");
+        ImGui::Checkbox("incremental background", &settings.incrementalBackground);
+        ImGui::Text("Background: %s", stats.backgroundReused ? "reused" : "shaded");
+
+        ImGui::Checkbox("dynamic resolution", &settings.dynamicResolution);
+        ImGui::SliderFloat("target frame ms", &settings.targetFrameMs, 1.f, 50.f);
+        ImGui::SliderFloat("min render scale", &settings.minRenderScale, 0.25f, 1.f);
+        ImGui::Text("Render extent: %ux%u (%.0f%%)", stats.renderExtent.width, stats.renderExtent.height,
+                    stats.renderScale * 100.f);
+        ImGui::Text("Render graph: %u passes, %u culled, %u barrier batches", stats.passCount, stats.culledPassCount,
+                    stats.barrierBatchCount);
+
+        constexpr std::array captureFormatNames = {"PNG", "EXR", "raw"};
+        int                  captureFormat = static_cast<int>(settings.captureFormat);
+        if(ImGui::Combo("capture format", &captureFormat, captureFormatNames.data(),
+                        static_cast<int>(captureFormatNames.size()))) {
+            settings.captureFormat = static_cast<CaptureFormat>(captureFormat);
+        }
+        ImGui::Checkbox("record frames", &settings.recording);
+        ImGui::SameLine();
+        if(ImGui::Button("screenshot")) {
+            settings.screenshotCount++;
+        }
+        ImGui::Text("Captured %llu frames to %s/, %llu dropped", static_cast<unsigned long long>(stats.capturedFrames),
+                    CAPTURE_DIRECTORY, static_cast<unsigned long long>(stats.droppedCaptures));
+#ifdef VKR_ENABLE_TRACING
+        bool tracing = Tracer::get().isEnabled();
+        if(ImGui::Checkbox("CPU trace (trace.json)", &tracing)) {
+            if(tracing) {
+                Tracer::get().start("trace.json");
+            } else {
+                Tracer::get().stop();
+            }
+        }
+#endif
 
-        ImGui::Text("Selected effect: %s", selected.name);
+        if(m_gpuProfiler.isSupported() && ImGui::BeginTable("gpu timings", 5, ImGuiTableFlags_Borders)) {
+            ImGui::TableSetupColumn("pass");
+            ImGui::TableSetupColumn("last ms");
+            ImGui::TableSetupColumn("min ms");
+            ImGui::TableSetupColumn("avg ms");
+            ImGui::TableSetupColumn("p99 ms");
+            ImGui::TableHeadersRow();
+            for(uint32_t i = 0; i < GPU_PASS_COUNT; i++) {
+                const auto& passStats = stats.gpuPasses[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(GpuProfiler::getPassName(static_cast<GpuPass>(i)));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", passStats.lastMs);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", passStats.minMs);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", passStats.avgMs);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", passStats.p99Ms);
+            }
+            ImGui::EndTable();
+            ImGui::Text("GPU frame: %.3f ms", stats.gpuFrameMs);
+        }
 
-        ImGui::SliderInt("Effect Index", &m_currentBackgroundEffect, 0, m_backgroundEffects.size() - 1);
-        ImGui::InputFloat4("data1", (float*)&selected.data.data1);
-        ImGui::InputFloat4("data2", (float*)&selected.data.data2);
-        ImGui::InputFloat4("data3", (float*)&selected.data.data3);
-        ImGui::InputFloat4("data4", (float*)&selected.data.data4);
+        constexpr float MB = 1024.f * 1024.f;
+        ImGui::Text("Memory budget: %s", m_memoryBudget ? "on" : "off");
+        // Other is what the process holds outside the allocator: pipelines, descriptor pools, swapchain images and
+        // the driver's own objects.
+        if(ImGui::BeginTable("memory heaps", 5, ImGuiTableFlags_Borders)) {
+            ImGui::TableSetupColumn("heap");
+            ImGui::TableSetupColumn("usage MB");
+            ImGui::TableSetupColumn("budget MB");
+            ImGui::TableSetupColumn("allocator MB");
+            ImGui::TableSetupColumn("other MB");
+            ImGui::TableHeadersRow();
+            for(uint32_t i = 0; i < stats.memoryHeaps.size(); i++) {
+                const auto& heap = stats.memoryHeaps[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", i);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", heap.usage / MB);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", heap.budget / MB);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f (%.1f used)", heap.blockBytes / MB, heap.usedBytes / MB);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", (heap.usage - std::min(heap.usage, heap.blockBytes)) / MB);
+            }
+            ImGui::EndTable();
+        }
+        for(uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+            ImGui::Text("%s: %.1f MB in %u allocations",
+                        DeviceAllocator::getCategoryName(static_cast<MemoryCategory>(i)),
+                        stats.memoryCategories[i].bytes / MB, stats.memoryCategories[i].allocationCount);
+        }
     }
     ImGui::End();
 
     ImGui::Render();
+
+    auto& input = m_frameInputs.back();
+    input.gui.copyFrom(*ImGui::GetDrawData());
+    textureLock.unlock();
+    input.settings = settings;
+    m_frameInputs.publish();
+}
+
+void GuiSnapshot::copyFrom(const ImDrawData& source) {
+    while(drawLists.size() < static_cast<size_t>(source.CmdLists.Size)) {
+        drawLists.push_back(std::make_unique<ImDrawList>(ImGui::GetDrawListSharedData()));
+    }
+    // Copies the display fields, the list pointers are swapped for the snapshot's own lists below.
+    drawData = source;
+    for(int i = 0; i < source.CmdLists.Size; i++) {
+        const ImDrawList& sourceList = *source.CmdLists[i];
+        ImDrawList&       list = *drawLists[i];
+        list.CmdBuffer = sourceList.CmdBuffer;
+        list.IdxBuffer = sourceList.IdxBuffer;
+        list.VtxBuffer = sourceList.VtxBuffer;
+        list.Flags = sourceList.Flags;
+        drawData.CmdLists[i] = &list;
+    }
 }
 #endif
 
-void Engine::initTrianglePipeline() {
-    auto vertShaderModule = utils::loadShaderModule(SHADER_DIR "/colored_triangle.vert.spv", m_device);
-    auto fragShaderModule = utils::loadShaderModule(SHADER_DIR "/colored_triangle.frag.spv", m_device);
+void Engine::initMeshPipeline() {
+    vk::PushConstantRange pushConstantRange{
+        .stageFlags = vk::ShaderStageFlagBits::eVertex,
+        .offset = 0,
+        .size = sizeof(MeshPushConstants),
+    };
+    vk::PipelineLayoutCreateInfo layoutInfo{
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    };
+    m_meshPipelineLayout = vk::raii::PipelineLayout(m_device, layoutInfo);
+
+    registerPipeline("mesh", &m_meshPipeline, {"mesh.vert.spv", "mesh.frag.spv"},
+                     [this] { return buildMeshPipeline(); });
+}
+
+void Engine::initMeshScene() {
+    // Demo content until there is a loader: a grid of coloured quads sharing one mesh.
+    constexpr uint32_t GRID_SIZE = 32;
+    constexpr float    CELL_SIZE = 2.f / GRID_SIZE;
+
+    const std::array<Vertex, 4> vertices = {{
+        {.position = {-0.5f, -0.5f, 0.f, 1.f}, .color = {1.f, 1.f, 1.f, 1.f}},
+        {.position = {0.5f, -0.5f, 0.f, 1.f}, .color = {0.8f, 0.8f, 0.8f, 1.f}},
+        {.position = {0.5f, 0.5f, 0.f, 1.f}, .color = {0.6f, 0.6f, 0.6f, 1.f}},
+        {.position = {-0.5f, 0.5f, 0.f, 1.f}, .color = {0.8f, 0.8f, 0.8f, 1.f}},
+    }};
+    const std::array<uint32_t, 6> indices = {0, 1, 2, 2, 3, 0};
+
+    std::vector<ObjectData>                     objects;
+    std::vector<vk::DrawIndexedIndirectCommand> commands;
+    for(uint32_t y = 0; y < GRID_SIZE; y++) {
+        for(uint32_t x = 0; x < GRID_SIZE; x++) {
+            glm::vec3 center{-1.f + (x + 0.5f) * CELL_SIZE, -1.f + (y + 0.5f) * CELL_SIZE, 0.f};
+            objects.push_back({
+                .transform = glm::scale(glm::translate(glm::mat4(1.f), center), glm::vec3(CELL_SIZE * 0.6f)),
+                .color = {static_cast<float>(x) / GRID_SIZE, static_cast<float>(y) / GRID_SIZE, 0.5f, 1.f},
+            });
+            commands.push_back({
+                .indexCount = static_cast<uint32_t>(indices.size()),
+                .instanceCount = 1,
+                .firstIndex = 0,
+                .vertexOffset = 0,
+                .firstInstance = static_cast<uint32_t>(commands.size()),
+            });
+        }
+    }
+    m_meshScene.maxDrawCount = static_cast<uint32_t>(commands.size());
+    uint32_t drawCount = m_meshScene.maxDrawCount;
+
+    auto addressable = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress;
+    m_meshScene.vertexBuffer = createDeviceBuffer(sizeof(vertices), addressable);
+    m_meshScene.indexBuffer = createDeviceBuffer(sizeof(indices), vk::BufferUsageFlagBits::eIndexBuffer);
+    m_meshScene.objectBuffer = createDeviceBuffer(objects.size() * sizeof(ObjectData), addressable);
+    m_meshScene.indirectBuffer = createDeviceBuffer(commands.size() * sizeof(vk::DrawIndexedIndirectCommand),
+                                                    vk::BufferUsageFlagBits::eIndirectBuffer);
+    m_meshScene.countBuffer = createDeviceBuffer(sizeof(uint32_t), vk::BufferUsageFlagBits::eIndirectBuffer);
+
+    // Landed before the first frame runs, every frame waits on the uploads flushed ahead of it.
+    m_uploadManager.uploadBuffer(m_meshScene.vertexBuffer, vertices.data(), sizeof(vertices));
+    m_uploadManager.uploadBuffer(m_meshScene.indexBuffer, indices.data(), sizeof(indices));
+    m_uploadManager.uploadBuffer(m_meshScene.objectBuffer, objects.data(), m_meshScene.objectBuffer.size);
+    m_uploadManager.uploadBuffer(m_meshScene.indirectBuffer, commands.data(), m_meshScene.indirectBuffer.size);
+    m_uploadManager.uploadBuffer(m_meshScene.countBuffer, &drawCount, sizeof(drawCount));
+}
 
+void Engine::initTrianglePipeline() {
     vk::PipelineLayoutCreateInfo layoutInfo{};
     m_trianglePipelineLayout = vk::raii::PipelineLayout(m_device, layoutInfo);
 
+    registerPipeline("colored_triangle", &m_trianglePipeline,
+                     {"colored_triangle.vert.spv", "colored_triangle.frag.spv"},
+                     [this] { return buildTrianglePipeline(); });
+}
+
+vk::raii::Pipeline Engine::buildTrianglePipeline() {
+    auto vertShaderModule = m_shaderLibrary.get("colored_triangle.vert.spv");
+    auto fragShaderModule = m_shaderLibrary.get("colored_triangle.frag.spv");
+
     PipelineBuilder pipelineBuilder{};
     pipelineBuilder.m_pipelineLayout = m_trianglePipelineLayout;
     pipelineBuilder.setShaders(vertShaderModule, fragShaderModule);
@@ -451,23 +1670,39 @@ void Engine::initTrianglePipeline() {
     pipelineBuilder.setColorAttachmentFormat(m_drawImage.format);
     pipelineBuilder.setDepthFormat(vk::Format::eUndefined);
 
-    m_trianglePipeline = pipelineBuilder.build(m_device);
+    return pipelineBuilder.build(m_device, m_pipelineCache.get());
 }
 
-void Engine::drawGeometry(vk::CommandBuffer cmd) {
-    auto colorAttachment = vkStructsUtils::makeColorAttachmentInfo(m_drawImage.imageView, nullptr,
-                                                                   vk::ImageLayout::eColorAttachmentOptimal);
-    auto renderingInfo = vkStructsUtils::makeRenderingInfo(
-        {.width = m_drawImage.imageExtent.width, .height = m_drawImage.imageExtent.height}, &colorAttachment, nullptr);
+vk::raii::Pipeline Engine::buildMeshPipeline() {
+    auto vertShaderModule = m_shaderLibrary.get("mesh.vert.spv");
+    auto fragShaderModule = m_shaderLibrary.get("mesh.frag.spv");
 
-    cmd.beginRendering(renderingInfo);
-    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_trianglePipeline);
+    // No vertex input state, mesh.vert fetches its vertices through the buffer address.
+    PipelineBuilder pipelineBuilder{};
+    pipelineBuilder.m_pipelineLayout = m_meshPipelineLayout;
+    pipelineBuilder.setShaders(vertShaderModule, fragShaderModule);
+    pipelineBuilder.setInputTopology(vk::PrimitiveTopology::eTriangleList);
+    pipelineBuilder.setPolygonMode(vk::PolygonMode::eFill);
+    pipelineBuilder.setCullMode(vk::CullModeFlagBits::eNone, vk::FrontFace::eClockwise);
+    pipelineBuilder.setMultiSamplingNone();
+    pipelineBuilder.disableBlending();
+    pipelineBuilder.disableDepthTest();
+    pipelineBuilder.setColorAttachmentFormat(m_drawImage.format);
+    pipelineBuilder.setDepthFormat(vk::Format::eUndefined);
+
+    return pipelineBuilder.build(m_device, m_pipelineCache.get());
+}
+
+void Engine::drawGeometry(vk::CommandBuffer cmd) {
+    if(!m_drawGeometry) {
+        return;
+    }
 
     vk::Viewport viewport = {};
     viewport.x = 0;
     viewport.y = 0;
-    viewport.width = m_drawImage.imageExtent.width;
-    viewport.height = m_drawImage.imageExtent.height;
+    viewport.width = m_renderExtent.width;
+    viewport.height = m_renderExtent.height;
     viewport.minDepth = 0.f;
     viewport.maxDepth = 1.f;
     cmd.setViewport(0, 1, &viewport);
@@ -475,10 +1710,216 @@ void Engine::drawGeometry(vk::CommandBuffer cmd) {
     vk::Rect2D scissor = {};
     scissor.offset.x = 0;
     scissor.offset.y = 0;
-    scissor.extent.width = m_drawImage.imageExtent.width;
-    scissor.extent.height = m_drawImage.imageExtent.height;
+    scissor.extent = m_renderExtent;
     cmd.setScissor(0, 1, &scissor);
 
-    cmd.draw(3, 1, 0, 0);
-    cmd.endRendering();
+    if(*m_trianglePipeline) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_trianglePipeline);
+        cmd.draw(3, 1, 0, 0);
+    }
+    drawMeshes(cmd);
+}
+
+void Engine::drawMeshes(vk::CommandBuffer cmd) {
+    if(!*m_meshPipeline) {
+        return;
+    }
+
+    // Keep quads square whatever the draw extent.
+    float aspect = static_cast<float>(m_renderExtent.height) / m_renderExtent.width;
+
+    MeshPushConstants pushConstants{
+        .viewProj = glm::scale(glm::mat4(1.f), glm::vec3(aspect, 1.f, 1.f)),
+        .vertexBuffer = m_meshScene.vertexBuffer.address,
+        .objectBuffer = m_meshScene.objectBuffer.address,
+    };
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_meshPipeline);
+    cmd.pushConstants(m_meshPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(MeshPushConstants),
+                      &pushConstants);
+    cmd.bindIndexBuffer(m_meshScene.indexBuffer.buffer, 0, vk::IndexType::eUint32);
+    cmd.drawIndexedIndirectCount(m_meshScene.indirectBuffer.buffer, 0, m_meshScene.countBuffer.buffer, 0,
+                                 m_meshScene.maxDrawCount, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+void Engine::recordSecondary(FrameData& frame, RecordJob job) {
+    VKR_TRACE_ZONE("recordSecondary");
+    auto index = static_cast<uint32_t>(job);
+    // Resetting the whole transient pool is cheaper than resetting its command buffer.
+    frame.recordPools[index].reset();
+    vk::CommandBuffer cmd = frame.recordCommandBuffers[index];
+
+    vk::CommandBufferInheritanceRenderingInfo renderingInheritance{
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &m_drawImage.format,
+        .rasterizationSamples = vk::SampleCountFlagBits::e1,
+    };
+    vk::CommandBufferInheritanceInfo inheritance{};
+    vk::CommandBufferUsageFlags      usage = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    if(job == RecordJob::eGeometry) {
+        // Executed inside the primary's dynamic rendering scope.
+        inheritance.pNext = &renderingInheritance;
+        usage |= vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+    }
+    cmd.begin(vk::CommandBufferBeginInfo{.flags = usage, .pInheritanceInfo = &inheritance});
+
+    switch(job) {
+        case RecordJob::eBackground:
+            // Shaded on the compute queue instead, or still valid from an earlier use.
+            if(m_asyncCompute || !frame.backgroundDirty) {
+                break;
+            }
+            if(m_bindless) {
+                m_bindlessTable.bind(cmd, vk::PipelineBindPoint::eCompute, m_gradientPipelineLayout);
+            }
+            if(frame.backgroundDirect) {
+                drawBackground(cmd, m_drawImage, frame.drawImageDescriptorSet, m_drawImageIndex);
+            } else {
+                drawBackground(cmd, frame.backgroundImage, frame.backgroundDescriptorSet, frame.backgroundImageIndex);
+            }
+            break;
+        case RecordJob::eGeometry:
+            drawGeometry(cmd);
+            break;
+        case RecordJob::eCount:
+            break;
+    }
+    cmd.end();
+}
+
+void Engine::recordSecondaries(FrameData& frame) {
+    VKR_TRACE_ZONE("recordSecondaries");
+    // The calling thread records the last job itself instead of idling on the workers.
+    uint32_t firstInlineJob = m_parallelRecording ? RECORD_JOB_COUNT - 1 : 0;
+
+    std::vector<std::future<void>> jobs;
+    for(uint32_t job = 0; job < firstInlineJob; job++) {
+        jobs.push_back(m_recordThreads.submit([this, &frame, job] { recordSecondary(frame, RecordJob(job)); }));
+    }
+    for(uint32_t job = firstInlineJob; job < RECORD_JOB_COUNT; job++) {
+        recordSecondary(frame, RecordJob(job));
+    }
+    for(auto& job : jobs) {
+        job.get();
+    }
+}
+
+ResourceUsage Engine::getBackgroundUsage() const {
+    // drawBackground() clears instead of dispatching while the effect is still compiling.
+    return *m_backgroundEffects[m_currentBackgroundEffect].pipeline ? ResourceUsage::eComputeStorageWrite
+                                                                    : ResourceUsage::eClear;
+}
+
+void Engine::updateBackgroundKey(FrameData& frame) {
+    const ComputeEffect& effect = m_backgroundEffects[m_currentBackgroundEffect];
+    // The pipeline handle covers both the compile fallback and pipelines swapped at runtime.
+    VkPipeline pipeline = *effect.pipeline;
+    uint64_t   key = utils::hashBytes(&m_currentBackgroundEffect, sizeof(m_currentBackgroundEffect));
+    key = utils::hashBytes(&pipeline, sizeof(pipeline), key);
+    key = utils::hashBytes(&effect.data, sizeof(effect.data), key);
+    key = utils::hashBytes(&m_renderExtent, sizeof(m_renderExtent), key);
+
+    frame.backgroundDirty = !m_incrementalBackground || key != frame.backgroundKey;
+    // Nothing would reuse the background image, copying it into the draw image would only cost a full-screen copy.
+    // The compute queue cannot write the draw image while the graphics queue uses it, so it always copies.
+    frame.backgroundDirect = !m_incrementalBackground && !m_asyncCompute;
+    // A direct frame leaves the background image stale, the key must not match it afterwards.
+    frame.backgroundKey = frame.backgroundDirect ? 0 : key;
+    m_backgroundReused = !frame.backgroundDirty;
+}
+
+void Engine::addScenePasses(RenderGraph& graph, const FrameData& frame, RenderGraphResource drawImage) {
+    vk::QueryPool queryPool = frame.queryPool;
+
+    if(frame.backgroundDirect) {
+        graph
+            .addPass("background",
+                     [this, &frame, queryPool](vk::CommandBuffer cmd) {
+                         m_gpuProfiler.beginPass(cmd, queryPool, GpuPass::eBackground);
+                         cmd.executeCommands(
+                             *frame.recordCommandBuffers[static_cast<uint32_t>(RecordJob::eBackground)]);
+                         m_gpuProfiler.endPass(cmd, queryPool, GpuPass::eBackground);
+                     })
+            .use(drawImage, getBackgroundUsage());
+    } else {
+        bool                shadeHere = frame.backgroundDirty && !m_asyncCompute;
+        RenderGraphResource backgroundImage;
+        if(m_asyncCompute) {
+            // Made visible by the compute timeline wait, the compute graph or an earlier frame left it in the copy
+            // layout.
+            backgroundImage = graph.importImage(frame.backgroundImage.image, vk::ImageLayout::eTransferSrcOptimal);
+        } else {
+            // Last copied from by an earlier frame on this queue, its contents are only kept when they are still valid.
+            backgroundImage = graph.importImage(
+                frame.backgroundImage.image,
+                frame.backgroundDirty ? vk::ImageLayout::eUndefined : vk::ImageLayout::eTransferSrcOptimal,
+                vk::PipelineStageFlagBits2::eAllTransfer);
+        }
+
+        if(shadeHere) {
+            graph
+                .addPass("background",
+                         [this, &frame, queryPool](vk::CommandBuffer cmd) {
+                             m_gpuProfiler.beginPass(cmd, queryPool, GpuPass::eBackground);
+                             cmd.executeCommands(
+                                 *frame.recordCommandBuffers[static_cast<uint32_t>(RecordJob::eBackground)]);
+                         })
+                .use(backgroundImage, getBackgroundUsage());
+        }
+        // The background timing covers shading, when it happens, and the copy.
+        graph
+            .addPass("background copy",
+                     [this, &frame, queryPool, shadeHere](vk::CommandBuffer cmd) {
+                         if(!shadeHere) {
+                             m_gpuProfiler.beginPass(cmd, queryPool, GpuPass::eBackground);
+                         }
+                         vk::ImageCopy region{
+                             .srcSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .layerCount = 1},
+                             .dstSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .layerCount = 1},
+                             .extent = {.width = m_renderExtent.width, .height = m_renderExtent.height, .depth = 1},
+                         };
+                         cmd.copyImage(frame.backgroundImage.image, vk::ImageLayout::eTransferSrcOptimal,
+                                       m_drawImage.image, vk::ImageLayout::eTransferDstOptimal, region);
+                         m_gpuProfiler.endPass(cmd, queryPool, GpuPass::eBackground);
+                     })
+            .use(backgroundImage, ResourceUsage::eTransferSrc)
+            .use(drawImage, ResourceUsage::eTransferDst);
+    }
+
+    graph
+        .addPass("geometry",
+                 [this, &frame, queryPool](vk::CommandBuffer cmd) {
+                     auto colorAttachment = vkStructsUtils::makeColorAttachmentInfo(
+                         m_drawImage.imageView, nullptr, vk::ImageLayout::eColorAttachmentOptimal);
+                     auto renderingInfo = vkStructsUtils::makeRenderingInfo(m_renderExtent, &colorAttachment, nullptr);
+                     renderingInfo.flags = vk::RenderingFlagBits::eContentsSecondaryCommandBuffers;
+
+                     m_gpuProfiler.beginPass(cmd, queryPool, GpuPass::eGeometry);
+                     cmd.beginRendering(renderingInfo);
+                     cmd.executeCommands(*frame.recordCommandBuffers[static_cast<uint32_t>(RecordJob::eGeometry)]);
+                     cmd.endRendering();
+                     m_gpuProfiler.endPass(cmd, queryPool, GpuPass::eGeometry);
+                 })
+        .use(drawImage, ResourceUsage::eColorAttachment);
+}
+
+void Engine::addCapturePass(RenderGraph& graph, RenderGraphResource drawImage, uint64_t timelineValue) {
+    vk::Buffer buffer = m_frameCapture.beginFrame(m_renderExtent, timelineValue);
+    if(!buffer) {
+        return;
+    }
+    auto target = graph.importBuffer(buffer);
+    graph
+        .addPass("capture",
+                 [this, buffer](vk::CommandBuffer cmd) {
+                     vk::BufferImageCopy region{
+                         .bufferOffset = 0,
+                         .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .layerCount = 1},
+                         .imageExtent = {.width = m_renderExtent.width, .height = m_renderExtent.height, .depth = 1},
+                     };
+                     cmd.copyImageToBuffer(m_drawImage.image, vk::ImageLayout::eTransferSrcOptimal, buffer, region);
+                 })
+        .use(drawImage, ResourceUsage::eTransferSrc)
+        .use(target, ResourceUsage::eTransferDst);
+    // The writers map it once the frame's timeline value is reached.
+    graph.exportResource(target, ResourceUsage::eHostRead);
 }
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "../include/FrameCapture.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    constexpr uint32_t TEXEL_SIZE = 4 * sizeof(uint16_t);
+
+    float halfToFloat(uint16_t half) {
+        uint32_t sign = (half & 0x8000u) << 16;
+        uint32_t exponent = (half >> 10) & 0x1fu;
+        uint32_t mantissa = half & 0x3ffu;
+        uint32_t bits;
+        if(exponent == 0) {
+            if(mantissa == 0) {
+                bits = sign;
+            } else {
+                // Subnormal, renormalize into a float exponent.
+                exponent = 127 - 15 + 1;
+                while(!(mantissa & 0x400u)) {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+            }
+        } else if(exponent == 0x1f) {
+            bits = sign | 0x7f800000u | (mantissa << 13);
+        } else {
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    template <typename T>
+    void writeValue(std::ofstream& file, T value) {
+        // Both formats are little endian, as are the hosts this renders on.
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    void writeBigEndian(std::vector<uint8_t>& out, T value) {
+        for(int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+        static const auto table = [] {
+            std::array<uint32_t, 256> table{};
+            for(uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for(int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                table[i] = c;
+            }
+            return table;
+        }();
+        crc = ~crc;
+        for(size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    void writePngChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> chunk;
+        writeBigEndian(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        // The CRC covers the type and the data, not the length.
+        writeBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    }
+
+    /**
+     * Stored deflate blocks inside a zlib stream keep the encoder trivial, PNG readers do not care.
+     */
+    void writePng(std::ofstream& file, const uint16_t* texels, vk::Extent2D extent) {
+        const size_t         rowSize = 1 + extent.width * 3;
+        std::vector<uint8_t> pixels(rowSize * extent.height);
+        for(uint32_t y = 0; y < extent.height; y++) {
+            uint8_t* row = &pixels[y * rowSize];
+            // Filter type none.
+            row[0] = 0;
+            for(uint32_t x = 0; x < extent.width; x++) {
+                const uint16_t* texel = texels + (size_t(y) * extent.width + x) * 4;
+                for(uint32_t c = 0; c < 3; c++) {
+                    float value = std::clamp(halfToFloat(texel[c]), 0.f, 1.f);
+                    row[1 + x * 3 + c] = static_cast<uint8_t>(value * 255.f + 0.5f);
+                }
+            }
+        }
+
+        constexpr uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+        std::vector<uint8_t> header;
+        writeBigEndian(header, extent.width);
+        writeBigEndian(header, extent.height);
+        // 8 bits per channel, RGB, deflate, adaptive filtering, no interlace.
+        header.insert(header.end(), {8, 2, 0, 0, 0});
+        writePngChunk(file, "IHDR", header);
+
+        constexpr size_t     MAX_STORED_BLOCK = 65535;
+        std::vector<uint8_t> zlib = {0x78, 0x01};
+        uint32_t             adlerA = 1;
+        uint32_t             adlerB = 0;
+        for(size_t offset = 0; offset < pixels.size(); offset += MAX_STORED_BLOCK) {
+            auto size = static_cast<uint16_t>(std::min(MAX_STORED_BLOCK, pixels.size() - offset));
+            zlib.push_back(offset + size == pixels.size() ? 1 : 0);
+            zlib.insert(zlib.end(), {uint8_t(size), uint8_t(size >> 8), uint8_t(~size), uint8_t(~size >> 8)});
+            zlib.insert(zlib.end(), pixels.begin() + offset, pixels.begin() + offset + size);
+            for(size_t i = offset; i < offset + size; i++) {
+                adlerA = (adlerA + pixels[i]) % 65521;
+                adlerB = (adlerB + adlerA) % 65521;
+            }
+        }
+        writeBigEndian(zlib, (adlerB << 16) | adlerA);
+        writePngChunk(file, "IDAT", zlib);
+        writePngChunk(file, "IEND", {});
+    }
+
+    void writeExrAttribute(std::ofstream& file, const char* name, const char* type, uint32_t size) {
+        file.write(name, std::strlen(name) + 1);
+        file.write(type, std::strlen(type) + 1);
+        writeValue(file, size);
+    }
+
+    /**
+     * Single part scanline EXR without compression, one scanline per block.
+     */
+    void writeExr(std::ofstream& file, const uint16_t* texels, vk::Extent2D extent) {
+        // Channels are stored in alphabetical order, texels are RGBA.
+        constexpr std::array<std::pair<char, uint32_t>, 4> channels = {{{'A', 3}, {'B', 2}, {'G', 1}, {'R', 0}}};
+        constexpr int32_t                                  HALF = 1;
+
+        writeValue(file, uint32_t(20000630));
+        writeValue(file, uint32_t(2));
+
+        writeExrAttribute(file, "channels", "chlist", channels.size() * 18 + 1);
+        for(const auto& [name, component] : channels) {
+            file.put(name).put('\0');
+            writeValue(file, HALF);
+            // pLinear and three reserved bytes.
+            writeValue(file, uint32_t(0));
+            writeValue(file, int32_t(1));
+            writeValue(file, int32_t(1));
+        }
+        file.put('\0');
+        writeExrAttribute(file, "compression", "compression", 1);
+        file.put('\0');
+        for(const char* window : {"dataWindow", "displayWindow"}) {
+            writeExrAttribute(file, window, "box2i", 16);
+            writeValue(file, int32_t(0));
+            writeValue(file, int32_t(0));
+            writeValue(file, int32_t(extent.width - 1));
+            writeValue(file, int32_t(extent.height - 1));
+        }
+        writeExrAttribute(file, "lineOrder", "lineOrder", 1);
+        file.put('\0');
+        writeExrAttribute(file, "pixelAspectRatio", "float", 4);
+        writeValue(file, 1.f);
+        writeExrAttribute(file, "screenWindowCenter", "v2f", 8);
+        writeValue(file, 0.f);
+        writeValue(file, 0.f);
+        writeExrAttribute(file, "screenWindowWidth", "float", 4);
+        writeValue(file, 1.f);
+        file.put('\0');
+
+        const uint32_t dataSize = extent.width * TEXEL_SIZE;
+        const uint64_t blockSize = 2 * sizeof(int32_t) + dataSize;
+        uint64_t       offset = static_cast<uint64_t>(file.tellp()) + extent.height * sizeof(uint64_t);
+        for(uint32_t y = 0; y < extent.height; y++) {
+            writeValue(file, offset + y * blockSize);
+        }
+
+        std::vector<uint16_t> block(extent.width * 4);
+        for(uint32_t y = 0; y < extent.height; y++) {
+            const uint16_t* row = texels + size_t(y) * extent.width * 4;
+            for(size_t c = 0; c < channels.size(); c++) {
+                for(uint32_t x = 0; x < extent.width; x++) {
+                    block[c * extent.width + x] = row[x * 4 + channels[c].second];
+                }
+            }
+            writeValue(file, int32_t(y));
+            writeValue(file, dataSize);
+            file.write(reinterpret_cast<const char*>(block.data()), dataSize);
+        }
+    }
+
+    const char* getExtension(CaptureFormat format) {
+        switch(format) {
+            case CaptureFormat::ePng:
+                return "png";
+            case CaptureFormat::eExr:
+                return "exr";
+            case CaptureFormat::eRaw:
+                return "rgba16f";
+        }
+        return "";
+    }
+}  // namespace
+
+void FrameCapture::record(const std::filesystem::path& directory, CaptureFormat format) {
+    start(directory, format, UINT64_MAX);
+}
+
+void FrameCapture::screenshot(const std::filesystem::path& directory, CaptureFormat format) {
+    // A running recording already captures the next frame.
+    if(!isRecording()) {
+        start(directory, format, 1);
+    }
+}
+
+void FrameCapture::start(const std::filesystem::path& directory, CaptureFormat format, uint64_t frameCount) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if(error) {
+        std::cerr << "Failed to create capture directory " << directory << ": " << error.message() << "\n";
+        return;
+    }
+    m_directory = directory;
+    m_format = format;
+    m_remainingFrames = frameCount;
+}
+
+vk::Buffer FrameCapture::beginFrame(vk::Extent2D extent, uint64_t timelineValue) {
+    if(m_remainingFrames == 0) {
+        return nullptr;
+    }
+    auto it = std::ranges::find_if(
+        m_slots, [](const Slot& slot) { return slot.state.load(std::memory_order_acquire) == SlotState::eFree; });
+    if(it == m_slots.end()) {
+        m_droppedCount++;
+        return nullptr;
+    }
+
+    Slot&                slot = *it;
+    const vk::DeviceSize size = vk::DeviceSize(extent.width) * extent.height * TEXEL_SIZE;
+    if(slot.buffer.size < size) {
+        // Free slots are neither read by the GPU nor by a writer.
+        slot.buffer = m_allocator->createBuffer(size, vk::BufferUsageFlagBits::eTransferDst, MemoryUsage::eGpuToCpu,
+                                                MemoryCategory::eReadback);
+    }
+    char name[64];
+    if(m_format == CaptureFormat::eRaw) {
+        std::snprintf(name, sizeof(name), "frame_%06llu_%ux%u.%s", static_cast<unsigned long long>(m_sequence),
+                      extent.width, extent.height, getExtension(m_format));
+    } else {
+        std::snprintf(name, sizeof(name), "frame_%06llu.%s", static_cast<unsigned long long>(m_sequence),
+                      getExtension(m_format));
+    }
+    m_sequence++;
+    if(m_remainingFrames != UINT64_MAX) {
+        m_remainingFrames--;
+    }
+
+    slot.extent = extent;
+    slot.timelineValue = timelineValue;
+    slot.path = m_directory / name;
+    slot.state.store(SlotState::eInFlight, std::memory_order_relaxed);
+    return *slot.buffer.buffer;
+}
+
+void FrameCapture::collect(uint64_t completedValue) {
+    for(auto& slot : m_slots) {
+        if(slot.state.load(std::memory_order_relaxed) != SlotState::eInFlight || slot.timelineValue > completedValue) {
+            continue;
+        }
+        slot.state.store(SlotState::eWriting, std::memory_order_relaxed);
+        m_writers.submit([this, &slot] { write(slot); });
+    }
+}
+
+void FrameCapture::write(Slot& slot) {
+    // Host coherent memory, made visible by the frame's final host read barrier and the timeline wait.
+    auto          texels = static_cast<const uint16_t*>(slot.buffer.allocation.getMappedData());
+    std::ofstream file(slot.path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open()) {
+        std::cerr << "Failed to write capture " << slot.path << ".\n";
+    } else {
+        if(slot.path.extension() == ".png") {
+            writePng(file, texels, slot.extent);
+        } else if(slot.path.extension() == ".exr") {
+            writeExr(file, texels, slot.extent);
+        } else {
+            file.write(reinterpret_cast<const char*>(texels),
+                       std::streamsize(slot.extent.width) * slot.extent.height * TEXEL_SIZE);
+        }
+        m_writtenCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    slot.state.store(SlotState::eFree, std::memory_order_release);
+}
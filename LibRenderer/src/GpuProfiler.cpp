@@ -0,0 +1,110 @@
+#include "../include/GpuProfiler.hpp"
+
+#include <algorithm>
+
+void GpuProfiler::init(const vk::raii::PhysicalDevice& gpu, uint32_t queueFamilyIndex) {
+    auto validBits = gpu.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+    m_supported = validBits != 0;
+    m_validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    m_timestampPeriod = gpu.getProperties().limits.timestampPeriod;
+}
+
+vk::raii::QueryPool GpuProfiler::createQueryPool(vk::raii::Device& device) const {
+    vk::QueryPoolCreateInfo poolInfo{
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = GPU_PASS_COUNT * 2,
+    };
+    return vk::raii::QueryPool(device, poolInfo);
+}
+
+void GpuProfiler::resetQueryPool(vk::CommandBuffer cmd, vk::QueryPool pool) const {
+    cmd.resetQueryPool(pool, 0, GPU_PASS_COUNT * 2);
+}
+
+void GpuProfiler::beginPass(vk::CommandBuffer cmd, vk::QueryPool pool, GpuPass pass) const {
+    if(!m_supported) {
+        return;
+    }
+    cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, pool, static_cast<uint32_t>(pass) * 2);
+}
+
+void GpuProfiler::endPass(vk::CommandBuffer cmd, vk::QueryPool pool, GpuPass pass) const {
+    if(!m_supported) {
+        return;
+    }
+    cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, pool, static_cast<uint32_t>(pass) * 2 + 1);
+}
+
+void GpuProfiler::collect(const vk::raii::QueryPool& pool) {
+    if(!m_supported) {
+        return;
+    }
+
+    // Each query yields {timestamp, availability}; the pool is reset at the start of every frame, so passes skipped
+    // in it report unavailable and cost nothing.
+    constexpr uint32_t queryCount = GPU_PASS_COUNT * 2;
+    auto [result, data] = pool.getResults<uint64_t>(0, queryCount, queryCount * 2 * sizeof(uint64_t),
+                                                    2 * sizeof(uint64_t),
+                                                    vk::QueryResultFlagBits::e64 |
+                                                        vk::QueryResultFlagBits::eWithAvailability);
+    if(result != vk::Result::eSuccess && result != vk::Result::eNotReady) {
+        return;
+    }
+
+    for(uint32_t pass = 0; pass < GPU_PASS_COUNT; pass++) {
+        const uint64_t* begin = &data[pass * 4];
+        const uint64_t* end = &data[pass * 4 + 2];
+        if(begin[1] == 0 || end[1] == 0) {
+            m_stats[pass].lastMs = 0.f;
+            continue;
+        }
+        uint64_t ticks = ((end[0] & m_validMask) - (begin[0] & m_validMask)) & m_validMask;
+        addSample(pass, static_cast<float>(ticks * m_timestampPeriod * 1e-6));
+    }
+}
+
+void GpuProfiler::addSample(uint32_t pass, float ms) {
+    auto& history = m_history[pass];
+    history[m_historyHead[pass]] = ms;
+    m_historyHead[pass] = (m_historyHead[pass] + 1) % HISTORY_SIZE;
+    m_historyCount[pass] = std::min(m_historyCount[pass] + 1, HISTORY_SIZE);
+
+    uint32_t                        count = m_historyCount[pass];
+    std::array<float, HISTORY_SIZE> sorted;
+    std::copy_n(history.begin(), count, sorted.begin());
+    std::sort(sorted.begin(), sorted.begin() + count);
+
+    float sum = 0.f;
+    for(uint32_t i = 0; i < count; i++) {
+        sum += sorted[i];
+    }
+
+    auto& stats = m_stats[pass];
+    stats.lastMs = ms;
+    stats.minMs = sorted[0];
+    stats.avgMs = sum / count;
+    stats.p99Ms = sorted[std::min(count - 1, static_cast<uint32_t>(count * 0.99f))];
+}
+
+float GpuProfiler::getFrameMs() const {
+    float total = 0.f;
+    for(const auto& stats : m_stats) {
+        total += stats.lastMs;
+    }
+    return total;
+}
+
+const char* GpuProfiler::getPassName(GpuPass pass) {
+    switch(pass) {
+        case GpuPass::eBackground:
+            return "background";
+        case GpuPass::eGeometry:
+            return "geometry";
+        case GpuPass::eBlit:
+            return "blit";
+        case GpuPass::eImGui:
+            return "imgui";
+        default:
+            return "unknown";
+    }
+}
@@ -15,7 +15,7 @@ void PipelineBuilder::clear() {
     m_shaderStages.clear();
 }
 
-vk::raii::Pipeline PipelineBuilder::build(vk::raii::Device& device) {
+vk::raii::Pipeline PipelineBuilder::build(vk::raii::Device& device, vk::Optional<const vk::raii::PipelineCache> cache) {
     vk::PipelineViewportStateCreateInfo viewport{
         .viewportCount = 1,
         .scissorCount = 1,
@@ -51,7 +51,7 @@ vk::raii::Pipeline PipelineBuilder::build(vk::raii::Device& device) {
         .pDynamicState = &dynamicInfo,
     };
 
-    return vk::raii::Pipeline(device, nullptr, pipelineInfo);
+    return vk::raii::Pipeline(device, cache, pipelineInfo);
 }
 
 void PipelineBuilder::setShaders(vk::ShaderModule vertexShader, vk::ShaderModule fragmentShader) {
@@ -0,0 +1,119 @@
+#include "../include/PipelineCache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "../include/Utils.hpp"
+
+void PipelineCache::init(vk::raii::Device& device, const vk::raii::PhysicalDevice& gpu,
+                         const std::filesystem::path& path) {
+    m_path = path;
+
+    auto properties = gpu.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+    const auto& deviceProperties = properties.get<vk::PhysicalDeviceProperties2>().properties;
+    const auto& idProperties = properties.get<vk::PhysicalDeviceIDProperties>();
+
+    m_expectedHeader = FileHeader{
+        .magic = MAGIC,
+        .fileVersion = FILE_VERSION,
+        .vendorID = deviceProperties.vendorID,
+        .deviceID = deviceProperties.deviceID,
+        .driverVersion = deviceProperties.driverVersion,
+    };
+    std::memcpy(m_expectedHeader.deviceUUID, idProperties.deviceUUID.data(), VK_UUID_SIZE);
+    std::memcpy(m_expectedHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+
+    auto                        initialData = loadValidated();
+    vk::PipelineCacheCreateInfo cacheInfo{
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.empty() ? nullptr : initialData.data(),
+    };
+    m_cache = vk::raii::PipelineCache(device, cacheInfo);
+}
+
+std::vector<uint8_t> PipelineCache::loadValidated() const {
+    std::ifstream file(m_path, std::ios::binary | std::ios::ate);
+    if(!file.is_open()) {
+        return {};
+    }
+
+    auto fileSize = static_cast<size_t>(file.tellg());
+    if(fileSize < sizeof(FileHeader)) {
+        std::cout << "Pipeline cache is truncated, ignoring it.\n";
+        return {};
+    }
+    file.seekg(0);
+
+    FileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+    if(header.magic != MAGIC || header.fileVersion != FILE_VERSION || header.vendorID != m_expectedHeader.vendorID ||
+       header.deviceID != m_expectedHeader.deviceID || header.driverVersion != m_expectedHeader.driverVersion ||
+       std::memcmp(header.deviceUUID, m_expectedHeader.deviceUUID, VK_UUID_SIZE) != 0 ||
+       std::memcmp(header.pipelineCacheUUID, m_expectedHeader.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        std::cout << "Pipeline cache was written by another device or driver, ignoring it.\n";
+        return {};
+    }
+    if(header.dataSize != fileSize - sizeof(FileHeader)) {
+        std::cout << "Pipeline cache size mismatch, ignoring it.\n";
+        return {};
+    }
+
+    std::vector<uint8_t> data(header.dataSize);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    if(!file || utils::hashBytes(data.data(), data.size()) != header.dataHash) {
+        std::cout << "Pipeline cache is corrupted, ignoring it.\n";
+        return {};
+    }
+
+    // The driver's own header: length, version, vendor, device and cache UUID.
+    vk::PipelineCacheHeaderVersionOne vkHeader;
+    if(data.size() < sizeof(vkHeader)) {
+        return {};
+    }
+    std::memcpy(&vkHeader, data.data(), sizeof(vkHeader));
+    if(vkHeader.headerSize < sizeof(vkHeader) || vkHeader.headerVersion != vk::PipelineCacheHeaderVersion::eOne ||
+       vkHeader.vendorID != m_expectedHeader.vendorID || vkHeader.deviceID != m_expectedHeader.deviceID ||
+       std::memcmp(vkHeader.pipelineCacheUUID.data(), m_expectedHeader.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        std::cout << "Pipeline cache header does not match the device, ignoring it.\n";
+        return {};
+    }
+
+    std::cout << "Loaded pipeline cache (" << data.size() << " bytes).\n";
+    return data;
+}
+
+void PipelineCache::save() const {
+    if(!*m_cache) {
+        return;
+    }
+
+    auto       data = m_cache.getData();
+    FileHeader header = m_expectedHeader;
+    header.dataSize = data.size();
+    header.dataHash = utils::hashBytes(data.data(), data.size());
+
+    // Write next to the target and rename over it so a crash never leaves a half-written cache behind.
+    auto tmpPath = m_path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if(!file.is_open()) {
+            std::cerr << "Failed to write pipeline cache to " << tmpPath << "\n";
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if(!file) {
+            std::cerr << "Failed to write pipeline cache to " << tmpPath << "\n";
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, m_path, ec);
+    if(ec) {
+        std::cerr << "Failed to replace pipeline cache: " << ec.message() << "\n";
+        std::filesystem::remove(tmpPath, ec);
+    }
+}
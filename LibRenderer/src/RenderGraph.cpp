@@ -0,0 +1,230 @@
+#include "../include/RenderGraph.hpp"
+
+#include "../include/Tracer.hpp"
+
+namespace {
+    struct UsageInfo {
+        vk::PipelineStageFlags2 stages;
+        vk::AccessFlags2        access;
+        vk::ImageLayout         layout;
+    };
+
+    constexpr vk::AccessFlags2 WRITE_ACCESS =
+        vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eColorAttachmentWrite |
+        vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eTransferWrite |
+        vk::AccessFlagBits2::eShaderWrite | vk::AccessFlagBits2::eMemoryWrite;
+
+    UsageInfo getUsageInfo(ResourceUsage usage) {
+        using Stage = vk::PipelineStageFlagBits2;
+        using Access = vk::AccessFlagBits2;
+        using Layout = vk::ImageLayout;
+        switch(usage) {
+            case ResourceUsage::eComputeStorageRead:
+                return {Stage::eComputeShader, Access::eShaderStorageRead, Layout::eGeneral};
+            case ResourceUsage::eComputeStorageWrite:
+                return {Stage::eComputeShader, Access::eShaderStorageWrite, Layout::eGeneral};
+            case ResourceUsage::eComputeSampled:
+                return {Stage::eComputeShader, Access::eShaderSampledRead, Layout::eShaderReadOnlyOptimal};
+            case ResourceUsage::eFragmentSampled:
+                return {Stage::eFragmentShader, Access::eShaderSampledRead, Layout::eShaderReadOnlyOptimal};
+            case ResourceUsage::eClear:
+                return {Stage::eClear, Access::eTransferWrite, Layout::eGeneral};
+            case ResourceUsage::eColorAttachment:
+                return {Stage::eColorAttachmentOutput, Access::eColorAttachmentRead | Access::eColorAttachmentWrite,
+                        Layout::eColorAttachmentOptimal};
+            case ResourceUsage::eTransferSrc:
+                return {Stage::eAllTransfer, Access::eTransferRead, Layout::eTransferSrcOptimal};
+            case ResourceUsage::eTransferDst:
+                return {Stage::eAllTransfer, Access::eTransferWrite, Layout::eTransferDstOptimal};
+            case ResourceUsage::eVertexStorageRead:
+                return {Stage::eVertexShader, Access::eShaderStorageRead, Layout::eUndefined};
+            case ResourceUsage::eIndirectRead:
+                return {Stage::eDrawIndirect, Access::eIndirectCommandRead, Layout::eUndefined};
+            case ResourceUsage::eHostRead:
+                return {Stage::eHost, Access::eHostRead, Layout::eUndefined};
+            case ResourceUsage::ePresent:
+                // The render finished semaphore is signaled at a stage covering this, which orders the transition.
+                return {Stage::eColorAttachmentOutput, Access::eNone, Layout::ePresentSrcKHR};
+        }
+        return {};
+    }
+
+    bool isWrite(ResourceUsage usage) { return bool(getUsageInfo(usage).access & WRITE_ACCESS); }
+    bool isRead(ResourceUsage usage) { return bool(getUsageInfo(usage).access & ~WRITE_ACCESS); }
+}  // namespace
+
+RenderGraph::Pass& RenderGraph::Pass::use(RenderGraphResource resource, ResourceUsage usage) {
+    m_accesses.push_back({.resource = resource, .usage = usage});
+    return *this;
+}
+
+void RenderGraph::reset() {
+    m_passes.clear();
+    m_resources.clear();
+}
+
+RenderGraphResource RenderGraph::importImage(vk::Image image, vk::ImageLayout layout,
+                                             vk::PipelineStageFlags2 lastStages, vk::AccessFlags2 lastAccess,
+                                             vk::ImageAspectFlags aspect) {
+    m_resources.push_back({
+        .image = image,
+        .range = {.aspectMask = aspect, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1},
+        .layout = layout,
+        .writeStages = lastStages,
+        .writeAccess = lastAccess & WRITE_ACCESS,
+    });
+    return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importBuffer(vk::Buffer buffer, vk::DeviceSize size,
+                                              vk::PipelineStageFlags2 lastStages, vk::AccessFlags2 lastAccess) {
+    m_resources.push_back({
+        .buffer = buffer,
+        .size = size,
+        .writeStages = lastStages,
+        .writeAccess = lastAccess & WRITE_ACCESS,
+    });
+    return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+void RenderGraph::exportResource(RenderGraphResource resource, ResourceUsage finalUsage) {
+    m_resources[resource].exported = true;
+    m_resources[resource].finalUsage = finalUsage;
+}
+
+RenderGraph::Pass& RenderGraph::addPass(std::string name, std::function<void(vk::CommandBuffer)> execute) {
+    Pass& pass = m_passes.emplace_back();
+    pass.m_name = std::move(name);
+    pass.m_execute = std::move(execute);
+    return pass;
+}
+
+void RenderGraph::execute(vk::CommandBuffer cmd) {
+    VKR_TRACE_ZONE("RenderGraph::execute");
+    std::vector<bool> live = cullPasses();
+    m_culledPassCount = 0;
+    m_barrierBatchCount = 0;
+
+    for(size_t i = 0; i < m_passes.size(); i++) {
+        if(!live[i]) {
+            m_culledPassCount++;
+            continue;
+        }
+        for(const auto& access : m_passes[i].m_accesses) {
+            addBarrier(m_resources[access.resource], access.usage);
+        }
+        flushBarriers(cmd);
+        m_passes[i].m_execute(cmd);
+    }
+
+    for(auto& resource : m_resources) {
+        if(resource.exported) {
+            addBarrier(resource, resource.finalUsage);
+        }
+    }
+    flushBarriers(cmd);
+}
+
+std::vector<bool> RenderGraph::cullPasses() const {
+    // Walk backwards from the exported resources, a pass survives when it writes something a later survivor reads.
+    std::vector<bool> needed(m_resources.size());
+    for(size_t i = 0; i < m_resources.size(); i++) {
+        needed[i] = m_resources[i].exported;
+    }
+
+    std::vector<bool> live(m_passes.size());
+    for(size_t i = m_passes.size(); i-- > 0;) {
+        for(const auto& access : m_passes[i].m_accesses) {
+            if(isWrite(access.usage) && needed[access.resource]) {
+                live[i] = true;
+            }
+        }
+        if(!live[i]) {
+            continue;
+        }
+        for(const auto& access : m_passes[i].m_accesses) {
+            if(isRead(access.usage)) {
+                needed[access.resource] = true;
+            }
+        }
+    }
+    return live;
+}
+
+void RenderGraph::addBarrier(Resource& resource, ResourceUsage usage) {
+    UsageInfo info = getUsageInfo(usage);
+    bool      write = isWrite(usage);
+    bool      layoutChange = resource.image && info.layout != resource.layout;
+
+    vk::PipelineStageFlags2 srcStages;
+    vk::AccessFlags2        srcAccess;
+    if(write || layoutChange) {
+        // Layout transitions are writes too, so they wait for earlier readers as well.
+        srcStages = resource.writeStages | resource.readStages;
+        srcAccess = resource.writeAccess;
+    } else if((info.stages & ~resource.readStages) || (info.access & ~resource.readAccess)) {
+        // First read at these stages since the last write.
+        srcStages = resource.writeStages;
+        srcAccess = resource.writeAccess;
+    }
+
+    if(layoutChange || srcStages) {
+        if(resource.image) {
+            m_imageBarriers.push_back({
+                .srcStageMask = srcStages,
+                .srcAccessMask = srcAccess,
+                .dstStageMask = info.stages,
+                .dstAccessMask = info.access,
+                .oldLayout = resource.layout,
+                .newLayout = info.layout,
+                .image = resource.image,
+                .subresourceRange = resource.range,
+            });
+        } else {
+            m_bufferBarriers.push_back({
+                .srcStageMask = srcStages,
+                .srcAccessMask = srcAccess,
+                .dstStageMask = info.stages,
+                .dstAccessMask = info.access,
+                .buffer = resource.buffer,
+                .offset = 0,
+                .size = resource.size,
+            });
+        }
+    }
+
+    if(write) {
+        resource.writeStages = info.stages;
+        resource.writeAccess = info.access & WRITE_ACCESS;
+        resource.readStages = {};
+        resource.readAccess = {};
+    } else if(layoutChange) {
+        // Readers at other stages still have to wait for the transition.
+        resource.writeStages = info.stages;
+        resource.writeAccess = {};
+        resource.readStages = info.stages;
+        resource.readAccess = info.access;
+    } else {
+        resource.readStages |= info.stages;
+        resource.readAccess |= info.access;
+    }
+    if(resource.image) {
+        resource.layout = info.layout;
+    }
+}
+
+void RenderGraph::flushBarriers(vk::CommandBuffer cmd) {
+    if(m_imageBarriers.empty() && m_bufferBarriers.empty()) {
+        return;
+    }
+    vk::DependencyInfo depInfo{
+        .bufferMemoryBarrierCount = static_cast<uint32_t>(m_bufferBarriers.size()),
+        .pBufferMemoryBarriers = m_bufferBarriers.data(),
+        .imageMemoryBarrierCount = static_cast<uint32_t>(m_imageBarriers.size()),
+        .pImageMemoryBarriers = m_imageBarriers.data(),
+    };
+    cmd.pipelineBarrier2(depInfo);
+    m_barrierBatchCount++;
+    m_imageBarriers.clear();
+    m_bufferBarriers.clear();
+}
\ No newline at end of file
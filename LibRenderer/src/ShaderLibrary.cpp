@@ -0,0 +1,99 @@
+#include "../include/ShaderLibrary.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "../include/Utils.hpp"
+
+#ifndef EMBEDDED_SHADERS
+const EmbeddedShader EMBEDDED_SHADERS[] = {{nullptr, nullptr, 0}};
+const size_t         EMBEDDED_SHADER_COUNT = 0;
+#endif
+
+bool ShaderLibrary::hasEmbeddedShaders() { return EMBEDDED_SHADER_COUNT != 0; }
+
+void ShaderLibrary::init(vk::raii::Device& device, ShaderSource source, const std::string& directory) {
+    m_device = &device;
+    m_directory = directory;
+    m_source = source;
+    if(m_source == ShaderSource::eEmbedded && !hasEmbeddedShaders()) {
+        std::cout << "No embedded shaders in this build, mapping them from " << directory << ".\n";
+        m_source = ShaderSource::eMapped;
+    }
+}
+
+vk::ShaderModule ShaderLibrary::get(const std::string& name) {
+    std::lock_guard lock(m_mutex);
+
+    auto it = m_nameToHash.find(name);
+    if(it != m_nameToHash.end()) {
+        return *m_modules.at(it->second);
+    }
+    bool embedded = m_source == ShaderSource::eEmbedded && !m_reloaded.contains(name);
+    return embedded ? loadEmbedded(name) : loadMapped(name);
+}
+
+void ShaderLibrary::reload(const std::string& name) {
+    std::lock_guard lock(m_mutex);
+    m_nameToHash.erase(name);
+    m_reloaded.insert(name);
+}
+
+vk::ShaderModule ShaderLibrary::createModule(const std::string& name, std::span<const uint32_t> code) {
+    uint64_t hash = utils::hashBytes(code.data(), code.size_bytes());
+    m_nameToHash[name] = hash;
+
+    auto it = m_modules.find(hash);
+    if(it == m_modules.end()) {
+        vk::ShaderModuleCreateInfo createInfo{
+            .codeSize = code.size_bytes(),
+            .pCode = code.data(),
+        };
+        it = m_modules.emplace(hash, vk::raii::ShaderModule(*m_device, createInfo)).first;
+    }
+    return *it->second;
+}
+
+vk::ShaderModule ShaderLibrary::loadEmbedded(const std::string& name) {
+    for(size_t i = 0; i < EMBEDDED_SHADER_COUNT; i++) {
+        if(name == EMBEDDED_SHADERS[i].name) {
+            return createModule(name, {EMBEDDED_SHADERS[i].code, EMBEDDED_SHADERS[i].size / sizeof(uint32_t)});
+        }
+    }
+    throw std::runtime_error("shader " + name + " is not embedded.");
+}
+
+vk::ShaderModule ShaderLibrary::loadMapped(const std::string& name) {
+    auto path = m_directory + "/" + name;
+    int  fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw std::runtime_error("failed to open file " + path);
+    }
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("failed to stat file " + path);
+    }
+    auto  size = static_cast<size_t>(fileStat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        throw std::runtime_error("failed to map file " + path);
+    }
+
+    // The driver copies the code during module creation, so the mapping is only needed for this call.
+    try {
+        auto module = createModule(name, {static_cast<const uint32_t*>(data), size / sizeof(uint32_t)});
+        munmap(data, size);
+        return module;
+    } catch(...) {
+        munmap(data, size);
+        throw;
+    }
+}
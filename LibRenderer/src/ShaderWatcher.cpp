@@ -0,0 +1,153 @@
+#include "../include/ShaderWatcher.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "../include/Tracer.hpp"
+
+namespace {
+    bool isShaderSource(const std::filesystem::path& path) {
+        auto extension = path.extension();
+        return extension == ".comp" || extension == ".vert" || extension == ".frag";
+    }
+}  // namespace
+
+void ShaderWatcher::start(const std::filesystem::path& sourceDirectory, const std::filesystem::path& outputDirectory,
+                          const std::string& compiler) {
+    stop();
+    m_sourceDirectory = sourceDirectory;
+    m_outputDirectory = outputDirectory;
+    m_compiler = compiler;
+    m_stopping = false;
+    m_thread = std::thread([this] {
+        VKR_TRACE_THREAD_NAME("shader watcher");
+        watchLoop();
+    });
+    std::cout << "Watching shaders in " << sourceDirectory << ".\n";
+}
+
+void ShaderWatcher::stop() {
+    m_stopping = true;
+    if(m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+std::vector<std::string> ShaderWatcher::takeCompiled() {
+    std::lock_guard lock(m_mutex);
+    return std::exchange(m_compiled, {});
+}
+
+#ifdef __linux__
+void ShaderWatcher::watchLoop() {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // Editors either rewrite the file in place or rename a temporary over it.
+    if(fd < 0 || inotify_add_watch(fd, m_sourceDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "Failed to watch " << m_sourceDirectory << ", shader hot reload is off.\n";
+        if(fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while(!m_stopping) {
+        pollfd pollInfo{.fd = fd, .events = POLLIN, .revents = 0};
+        if(poll(&pollInfo, 1, static_cast<int>(POLL_INTERVAL.count())) <= 0) {
+            continue;
+        }
+        // A save often produces several events, compile each file once per batch.
+        std::set<std::string> changed;
+        ssize_t               length;
+        while((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            for(char* it = buffer; it < buffer + length;) {
+                auto event = reinterpret_cast<const inotify_event*>(it);
+                if(event->len > 0 && isShaderSource(event->name)) {
+                    changed.insert(event->name);
+                }
+                it += sizeof(inotify_event) + event->len;
+            }
+        }
+        for(const auto& name : changed) {
+            compile(name);
+        }
+    }
+    close(fd);
+}
+#else
+void ShaderWatcher::watchLoop() {
+    std::unordered_map<std::string, std::filesystem::file_time_type> lastWrite;
+    bool                                                             firstScan = true;
+    while(!m_stopping) {
+        std::error_code error;
+        for(const auto& entry : std::filesystem::directory_iterator(m_sourceDirectory, error)) {
+            if(!entry.is_regular_file() || !isShaderSource(entry.path())) {
+                continue;
+            }
+            auto name = entry.path().filename().string();
+            auto time = entry.last_write_time(error);
+            auto [it, inserted] = lastWrite.try_emplace(name, time);
+            // The first scan only records the current state, the build already compiled those sources.
+            if(!firstScan && (inserted || it->second != time)) {
+                it->second = time;
+                compile(name);
+            }
+        }
+        firstScan = false;
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+}
+#endif
+
+void ShaderWatcher::compile(const std::string& sourceName) {
+    VKR_TRACE_ZONE("ShaderWatcher::compile");
+    auto source = m_sourceDirectory / sourceName;
+    std::cout << "Recompiling " << sourceName << ".\n";
+
+    std::vector<std::string> outputs = {sourceName + ".spv"};
+    if(source.extension() == ".comp") {
+        outputs.push_back(sourceName + ".bindless.spv");
+    }
+    for(size_t i = 0; i < outputs.size(); i++) {
+        if(!runCompiler(source, outputs[i], i == 0 ? nullptr : "BINDLESS")) {
+            return;
+        }
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_compiled.insert(m_compiled.end(), outputs.begin(), outputs.end());
+}
+
+bool ShaderWatcher::runCompiler(const std::filesystem::path& source, const std::string& outputName,
+                                const char* define) {
+    // Compile next to the target and rename over it, so the library never maps a half written file.
+    auto output = m_outputDirectory / outputName;
+    auto temporary = m_outputDirectory / (outputName + ".tmp");
+
+    std::string command = "\"" + m_compiler + "\" --target-env=vulkan1.3 ";
+    if(define) {
+        command += std::string("-D") + define + " ";
+    }
+    command += "\"" + source.string() + "\" -o \"" + temporary.string() + "\"";
+    if(std::system(command.c_str()) != 0) {
+        std::cerr << "Failed to compile " << source.filename() << ", keeping the previous " << outputName << ".\n";
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, output, error);
+    if(error) {
+        std::cerr << "Failed to replace " << output << ": " << error.message() << "\n";
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
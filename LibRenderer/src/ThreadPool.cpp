@@ -0,0 +1,45 @@
+#include "../include/ThreadPool.hpp"
+
+#include <algorithm>
+
+#include "../include/Tracer.hpp"
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+    for(uint32_t i = 0; i < threadCount; i++) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    for(auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+uint32_t ThreadPool::getDefaultThreadCount() {
+    // Leave one core for the thread that submits the work.
+    uint32_t cores = std::thread::hardware_concurrency();
+    return std::max(1u, cores > 1 ? cores - 1 : 1u);
+}
+
+void ThreadPool::workerLoop() {
+    VKR_TRACE_THREAD_NAME("worker");
+    while(true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if(m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
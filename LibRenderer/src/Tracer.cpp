@@ -0,0 +1,120 @@
+#include "../include/Tracer.hpp"
+
+#ifdef VKR_ENABLE_TRACING
+
+#include <iomanip>
+#include <iostream>
+
+Tracer& Tracer::get() {
+    static Tracer tracer;
+    return tracer;
+}
+
+bool Tracer::start(const std::filesystem::path& path) {
+    std::lock_guard lock(m_controlMutex);
+    if(m_flusher.joinable()) {
+        return true;
+    }
+    m_file.open(path, std::ios::trunc);
+    if(!m_file.is_open()) {
+        std::cerr << "Failed to open trace file " << path << ".\n";
+        return false;
+    }
+    m_file << std::fixed << std::setprecision(3) << "[\n";
+    m_firstEvent = true;
+    m_droppedCount = 0;
+    {
+        std::lock_guard ringsLock(m_ringsMutex);
+        for(auto& ring : m_rings) {
+            ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+            ring->nameWritten = false;
+        }
+    }
+
+    m_stopping = false;
+    m_flusher = std::thread([this] { flushLoop(); });
+    m_enabled = true;
+    std::cout << "Tracing CPU zones to " << path << ".\n";
+    return true;
+}
+
+void Tracer::stop() {
+    std::lock_guard lock(m_controlMutex);
+    if(!m_flusher.joinable()) {
+        return;
+    }
+    // Zones already open still complete into their rings, the final drain picks up whatever made it in time.
+    m_enabled = false;
+    m_stopping = true;
+    m_flusher.join();
+    drain();
+    m_file << "\n]\n";
+    m_file.close();
+    if(m_droppedCount > 0) {
+        std::cerr << "Trace rings overflowed, " << m_droppedCount << " zones were dropped.\n";
+    }
+}
+
+void Tracer::record(const char* name, uint64_t startNs, uint64_t endNs) {
+    ThreadRing& ring = getThreadRing();
+    uint64_t    head = ring.head.load(std::memory_order_relaxed);
+    if(head - ring.tail.load(std::memory_order_acquire) >= RING_CAPACITY) {
+        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring.events[head % RING_CAPACITY] = {.name = name, .startNs = startNs, .durationNs = endNs - startNs};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::setThreadName(const char* name) {
+    getThreadRing().name.store(name, std::memory_order_release);
+}
+
+Tracer::ThreadRing& Tracer::getThreadRing() {
+    thread_local ThreadRing* ring = nullptr;
+    if(!ring) {
+        std::lock_guard lock(m_ringsMutex);
+        ring = m_rings.emplace_back(std::make_unique<ThreadRing>()).get();
+        ring->threadId = static_cast<uint32_t>(m_rings.size());
+    }
+    return *ring;
+}
+
+void Tracer::flushLoop() {
+    while(!m_stopping) {
+        std::this_thread::sleep_for(FLUSH_INTERVAL);
+        drain();
+    }
+}
+
+void Tracer::drain() {
+    std::lock_guard lock(m_ringsMutex);
+    for(auto& ring : m_rings) {
+        auto separator = [this] {
+            m_file << (m_firstEvent ? "" : ",\n");
+            m_firstEvent = false;
+        };
+
+        const char* name = ring->name.load(std::memory_order_acquire);
+        if(name && !ring->nameWritten) {
+            separator();
+            m_file << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << ring->threadId << R"(,"args":{"name":")"
+                   << name << "\"}}";
+            ring->nameWritten = true;
+        }
+
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        for(; tail < head; tail++) {
+            const Event& event = ring->events[tail % RING_CAPACITY];
+            separator();
+            // Timestamps are in microseconds.
+            m_file << R"({"name":")" << event.name << R"(","ph":"X","pid":1,"tid":)" << ring->threadId
+                   << R"(,"ts":)" << event.startNs / 1000.0 << R"(,"dur":)" << event.durationNs / 1000.0 << "}";
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    m_file.flush();
+}
+
+#endif
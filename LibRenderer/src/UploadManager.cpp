@@ -0,0 +1,162 @@
+#include "../include/UploadManager.hpp"
+
+#include <cstring>
+
+#include "../include/Utils.hpp"
+
+void UploadManager::init(vk::raii::Device& device, DeviceAllocator& allocator, vk::raii::Queue queue,
+                         uint32_t queueFamilyIndex, std::mutex* queueMutex, vk::DeviceSize ringSize) {
+    m_device = &device;
+    m_allocator = &allocator;
+    m_queue = std::move(queue);
+    m_queueFamilyIndex = queueFamilyIndex;
+    m_queueMutex = queueMutex;
+
+    vk::CommandPoolCreateInfo poolInfo{
+        .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = queueFamilyIndex,
+    };
+    m_commandPool = vk::raii::CommandPool(device, poolInfo);
+
+    vk::SemaphoreTypeCreateInfo timelineInfo{
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue = 0,
+    };
+    m_timeline = vk::raii::Semaphore(device, vk::SemaphoreCreateInfo{.pNext = &timelineInfo});
+
+    m_ring = allocator.createBuffer(ringSize, vk::BufferUsageFlagBits::eTransferSrc, MemoryUsage::eCpuToGpu,
+                                    MemoryCategory::eStaging);
+    m_ringData = static_cast<std::byte*>(m_ring.allocation.getMappedData());
+}
+
+void UploadManager::uploadBuffer(const AllocatedBuffer& dst, const void* data, vk::DeviceSize size,
+                                 vk::DeviceSize dstOffset) {
+    std::lock_guard lock(m_mutex);
+
+    vk::Buffer src;
+    auto       srcOffset = stage(data, size, src);
+    auto       cmd = beginRecording();
+    cmd.copyBuffer(src, dst.buffer, vk::BufferCopy{.srcOffset = srcOffset, .dstOffset = dstOffset, .size = size});
+}
+
+uint64_t UploadManager::flush() {
+    std::lock_guard lock(m_mutex);
+    reclaim(false);
+    return submit();
+}
+
+void UploadManager::wait(uint64_t value) {
+    {
+        std::lock_guard lock(m_mutex);
+        if(value > m_submittedValue) {
+            submit();
+        }
+    }
+    vk::SemaphoreWaitInfo waitInfo{
+        .semaphoreCount = 1,
+        .pSemaphores = &*m_timeline,
+        .pValues = &value,
+    };
+    VK_CHECK(m_device->waitSemaphores(waitInfo, UINT64_MAX));
+}
+
+vk::CommandBuffer UploadManager::beginRecording() {
+    if(!*m_recording.commandBuffer) {
+        if(m_freeCommandBuffers.empty()) {
+            vk::CommandBufferAllocateInfo allocInfo{
+                .commandPool = m_commandPool,
+                .level = vk::CommandBufferLevel::ePrimary,
+                .commandBufferCount = 1,
+            };
+            m_recording.commandBuffer = std::move(m_device->allocateCommandBuffers(allocInfo)[0]);
+        } else {
+            m_recording.commandBuffer = std::move(m_freeCommandBuffers.back());
+            m_freeCommandBuffers.pop_back();
+            m_recording.commandBuffer.reset();
+        }
+        m_recording.commandBuffer.begin(
+            vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    }
+    return m_recording.commandBuffer;
+}
+
+vk::DeviceSize UploadManager::stage(const void* data, vk::DeviceSize size, vk::Buffer& outBuffer) {
+    const uint64_t ringSize = m_ring.size;
+    if(size > ringSize) {
+        auto& staging = m_recording.oversizeStaging.emplace_back(
+            m_allocator->createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, MemoryUsage::eCpuToGpu,
+                                      MemoryCategory::eStaging));
+        std::memcpy(staging.allocation.getMappedData(), data, size);
+        outBuffer = staging.buffer;
+        return 0;
+    }
+
+    uint64_t start;
+    for(;;) {
+        if(m_ringTail == m_ringHead) {
+            // Nothing staged, restart at the beginning of the ring.
+            m_ringHead = m_ringTail = utils::alignUp(m_ringHead, ringSize);
+        }
+        start = utils::alignUp(m_ringHead, COPY_ALIGNMENT);
+        // Copies never straddle the end of the ring, the skipped tail is released with the batch.
+        if(start % ringSize + size > ringSize) {
+            start += ringSize - start % ringSize;
+        }
+        if(start + size - m_ringTail <= ringSize) {
+            break;
+        }
+        if(m_inFlight.empty()) {
+            // The batch being recorded fills the ring by itself.
+            submit();
+        }
+        reclaim(true);
+    }
+
+    m_ringHead = start + size;
+    std::memcpy(m_ringData + start % ringSize, data, size);
+    outBuffer = m_ring.buffer;
+    return start % ringSize;
+}
+
+uint64_t UploadManager::submit() {
+    if(!*m_recording.commandBuffer) {
+        return m_submittedValue;
+    }
+    m_recording.commandBuffer.end();
+    m_recording.timelineValue = ++m_submittedValue;
+    m_recording.ringEnd = m_ringHead;
+
+    auto cmdInfo = vkStructsUtils::makeCommandBufferSubmitInfo(m_recording.commandBuffer);
+    auto signalInfo = vkStructsUtils::makeSemaphoreSubmitInfo(vk::PipelineStageFlagBits2::eAllCommands, m_timeline,
+                                                              m_recording.timelineValue);
+    auto submitInfo = vkStructsUtils::makeSubmitInfo(&cmdInfo, &signalInfo, nullptr);
+    {
+        std::unique_lock<std::mutex> queueLock;
+        if(m_queueMutex) {
+            queueLock = std::unique_lock(*m_queueMutex);
+        }
+        m_queue.submit2(submitInfo);
+    }
+
+    m_inFlight.push_back(std::move(m_recording));
+    m_recording = Batch{};
+    return m_submittedValue;
+}
+
+void UploadManager::reclaim(bool waitForOldest) {
+    if(waitForOldest && !m_inFlight.empty()) {
+        vk::SemaphoreWaitInfo waitInfo{
+            .semaphoreCount = 1,
+            .pSemaphores = &*m_timeline,
+            .pValues = &m_inFlight.front().timelineValue,
+        };
+        VK_CHECK(m_device->waitSemaphores(waitInfo, UINT64_MAX));
+    }
+
+    uint64_t completed = m_timeline.getCounterValue();
+    while(!m_inFlight.empty() && m_inFlight.front().timelineValue <= completed) {
+        m_ringTail = m_inFlight.front().ringEnd;
+        m_freeCommandBuffers.push_back(std::move(m_inFlight.front().commandBuffer));
+        m_inFlight.pop_front();
+    }
+}
@@ -1,7 +1,5 @@
 #include "../include/Utils.hpp"
 
-#include <fstream>
-
 uint32_t utils::findMemoryTypeIndex(vk::PhysicalDevice gpu, uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
     auto memProperties = gpu.getMemoryProperties();
     for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
@@ -12,23 +10,15 @@ uint32_t utils::findMemoryTypeIndex(vk::PhysicalDevice gpu, uint32_t typeFilter,
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
-vk::raii::ShaderModule utils::loadShaderModule(const char* filePath, vk::raii::Device& device) {
-    std::ifstream file(filePath, std::ios::ate | std::ios::binary);
-    if(!file.is_open()) {
-        throw std::runtime_error("failed to open file.");
+uint64_t utils::hashBytes(const void* data, size_t size, uint64_t seed) {
+    // FNV-1a, good enough for cache keys and change detection.
+    auto     bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
     }
-    auto                  fileSize = file.tellg();
-    std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
-    file.seekg(0);
-    file.read((char*)buffer.data(), fileSize);
-    file.close();
-
-    vk::ShaderModuleCreateInfo createInfo{
-        .codeSize = buffer.size() * sizeof(uint32_t),
-        .pCode = buffer.data(),
-    };
-
-    return vk::raii::ShaderModule(device, createInfo);
+    return hash;
 }
 
 void imageUtils::transitionImage(vk::CommandBuffer cmd, vk::Image image, vk::ImageLayout currentLayout,
@@ -0,0 +1,63 @@
+#include "../include/WorkgroupSizeCache.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+void WorkgroupSizeCache::init(const vk::raii::PhysicalDevice& gpu, const std::filesystem::path& path) {
+    m_path = path;
+    auto properties = gpu.getProperties();
+    m_vendorID = properties.vendorID;
+    m_deviceID = properties.deviceID;
+    m_driverVersion = properties.driverVersion;
+
+    std::ifstream file(m_path);
+    Entry         entry;
+    while(file >> entry.vendorID >> entry.deviceID >> entry.driverVersion >> entry.effect >> entry.size.width >>
+          entry.size.height) {
+        if(entry.size.width == 0 || entry.size.height == 0) {
+            continue;
+        }
+        m_entries.push_back(entry);
+    }
+}
+
+void WorkgroupSizeCache::save() const {
+    std::ofstream file(m_path, std::ios::trunc);
+    if(!file.is_open()) {
+        std::cerr << "Failed to write workgroup sizes to " << m_path << ".\n";
+        return;
+    }
+    for(const auto& entry : m_entries) {
+        file << entry.vendorID << ' ' << entry.deviceID << ' ' << entry.driverVersion << ' ' << entry.effect << ' '
+             << entry.size.width << ' ' << entry.size.height << '\n';
+    }
+}
+
+std::optional<vk::Extent2D> WorkgroupSizeCache::find(const std::string& effect) const {
+    auto it = std::ranges::find_if(
+        m_entries, [&](const Entry& entry) { return isCurrentDevice(entry) && entry.effect == effect; });
+    if(it == m_entries.end()) {
+        return std::nullopt;
+    }
+    return it->size;
+}
+
+void WorkgroupSizeCache::store(const std::string& effect, vk::Extent2D size) {
+    std::erase_if(m_entries, [&](const Entry& entry) { return isCurrentDevice(entry) && entry.effect == effect; });
+    m_entries.push_back({
+        .vendorID = m_vendorID,
+        .deviceID = m_deviceID,
+        .driverVersion = m_driverVersion,
+        .effect = effect,
+        .size = size,
+    });
+}
+
+void WorkgroupSizeCache::clear() {
+    std::erase_if(m_entries, [this](const Entry& entry) { return isCurrentDevice(entry); });
+}
+
+bool WorkgroupSizeCache::isCurrentDevice(const Entry& entry) const {
+    return entry.vendorID == m_vendorID && entry.deviceID == m_deviceID && entry.driverVersion == m_driverVersion;
+}
\ No newline at end of file
@@ -4,14 +4,21 @@
 #include <imgui_impl_vulkan.h>
 #include <vulkan/vulkan.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include <vulkan/vulkan_raii.hpp>
 
 #include "Engine.hpp"
 
 constexpr int WINDOW_WIDTH = 640;
 constexpr int WINDOW_HEIGHT = 480;
+// Input sampling and GUI rate while the engine draws on its own thread.
+constexpr auto INPUT_INTERVAL = std::chrono::milliseconds(4);
 
 void throwSDLError(const char* api) {
     std::stringstream ss;
@@ -20,7 +27,7 @@ void throwSDLError(const char* api) {
 }
 
 void createSDLSurface(const vk::Instance& vkInstance, SDL_Window*& window, VkSurfaceKHR& surface) {
-    window = SDL_CreateWindow("Vk SDL Project", WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_VULKAN);
+    window = SDL_CreateWindow("Vk SDL Project", WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
     if(window == nullptr) {
         throwSDLError("SDL_CreateWindow");
     }
@@ -33,20 +40,54 @@ void createSDLSurface(const vk::Instance& vkInstance, SDL_Window*& window, VkSur
 void mainLoop(Engine& engine) {
     SDL_Event e;
     bool      bQuit{false};
+    auto      nextTick = std::chrono::steady_clock::now();
 
     while(!bQuit) {
-        while(SDL_PollEvent(&e)) {
-            if(e.type == SDL_EVENT_QUIT || e.type == SDL_EVENT_TERMINATING) bQuit = true;
-
-            ImGui_ImplSDL3_ProcessEvent(&e);
+        VKR_TRACE_ZONE("frame");
+        {
+            VKR_TRACE_ZONE("SDL_PollEvent");
+            if(engine.isMinimized() && !engine.isRenderThreadRunning()) {
+                // Nothing to draw until the window is restored, block instead of spinning through draw().
+                SDL_WaitEvent(nullptr);
+            }
+            while(SDL_PollEvent(&e)) {
+                if(e.type == SDL_EVENT_QUIT || e.type == SDL_EVENT_TERMINATING) bQuit = true;
+                if(e.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED) engine.resize(e.window.data1, e.window.data2);
+
+                ImGui_ImplSDL3_ProcessEvent(&e);
+            }
         }
 
         engine.setupGui();
-        engine.draw();
+        if(!engine.isRenderThreadRunning()) {
+            engine.draw();
+            continue;
+        }
+        // Nothing here waits on the GPU, so input is sampled at a steady rate however long frames take.
+        nextTick = std::max(nextTick + INPUT_INTERVAL, std::chrono::steady_clock::now());
+        std::this_thread::sleep_until(nextTick);
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    bool renderThread = true;
+    // Index, UUID or part of the name of the GPU to use, the best scored one otherwise.
+    std::string device = std::getenv("VKR_DEVICE") ? std::getenv("VKR_DEVICE") : "";
+    for(int i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "--single-thread") == 0) {
+            renderThread = false;
+        } else if(std::strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+            device = argv[++i];
+        }
+    }
+
+    VKR_TRACE_THREAD_NAME("main");
+#ifdef VKR_ENABLE_TRACING
+    // Capture from the first frame, the GUI can also toggle tracing while running.
+    if(const char* tracePath = std::getenv("VKR_TRACE_FILE")) {
+        Tracer::get().start(tracePath);
+    }
+#endif
     SDL_Init(SDL_INIT_VIDEO);
 
     uint32_t                 count;
@@ -64,11 +105,27 @@ int main() {
         SDL_Window*  window = nullptr;
 
         createSDLSurface(engine.m_instance, window, SDLSurface);
+
+        int width, height;
+        SDL_GetWindowSizeInPixels(window, &width, &height);
+        engine.resize(width, height);
+        engine.setDevicePreference(device);
+#ifndef NDEBUG
+        engine.setShaderHotReload(true);
+#endif
+        engine.setMemoryBudgetCallback(0.9f, [](uint32_t heapIndex, const MemoryHeapStats& stats) {
+            std::cerr << "Memory heap " << heapIndex << " is at " << stats.usage / (1024 * 1024) << " of "
+                      << stats.budget / (1024 * 1024) << " MB budget.\n";
+        });
         engine.initWithSurface(SDLSurface);
         engine.initImGUI(window);
 
         std::cout << "vk render app.\n";
+        if(renderThread) {
+            engine.startRenderThread();
+        }
         mainLoop(engine);
+        engine.stopRenderThread();
 
         SDL_DestroyWindow(window);
         SDL_Quit();
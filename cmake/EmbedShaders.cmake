@@ -0,0 +1,29 @@
+# Turns compiled SPIR-V files into a C++ source with one constexpr word array per shader.
+# Usage: cmake -DOUTPUT=<file.cpp> -DSPV_FILES=<a.spv|b.spv> -P EmbedShaders.cmake
+string(REPLACE "|" ";" SPV_FILES "${SPV_FILES}")
+
+set(ARRAYS "")
+set(TABLE "")
+set(INDEX 0)
+foreach(SPV ${SPV_FILES})
+    get_filename_component(NAME ${SPV} NAME)
+    file(READ ${SPV} HEX HEX)
+    # SPIR-V is a stream of little-endian 32-bit words.
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u," WORDS "${HEX}")
+    string(APPEND ARRAYS "static constexpr uint32_t SHADER_${INDEX}[] = {${WORDS}};\n")
+    string(APPEND TABLE "    {\"${NAME}\", SHADER_${INDEX}, sizeof(SHADER_${INDEX})},\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+set(CONTENT "// Generated by cmake/EmbedShaders.cmake, do not edit.\n#include \"ShaderLibrary.hpp\"\n\n")
+string(APPEND CONTENT "${ARRAYS}\n")
+string(APPEND CONTENT "const EmbeddedShader EMBEDDED_SHADERS[] = {\n${TABLE}};\n")
+string(APPEND CONTENT "const size_t EMBEDDED_SHADER_COUNT = ${INDEX};\n")
+
+# Only touch the output when it changed so dependents don't rebuild needlessly.
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} OLD_CONTENT)
+endif()
+if(NOT "${OLD_CONTENT}" STREQUAL "${CONTENT}")
+    file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
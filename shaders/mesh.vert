@@ -0,0 +1,37 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+
+struct Vertex {
+    vec4 position;
+    vec4 color;
+};
+
+struct ObjectData {
+    mat4 transform;
+    vec4 color;
+};
+
+layout(buffer_reference, std430) readonly buffer VertexBuffer {
+    Vertex vertices[];
+};
+
+layout(buffer_reference, std430) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(push_constant) uniform constants {
+    mat4 viewProj;
+    VertexBuffer vertexBuffer;
+    ObjectBuffer objectBuffer;
+} PushConstants;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // firstInstance of each indirect command selects the object.
+    Vertex v = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+    ObjectData object = PushConstants.objectBuffer.objects[gl_InstanceIndex];
+
+    gl_Position = PushConstants.viewProj * object.transform * v.position;
+    outColor = v.color * object.color;
+}